@@ -0,0 +1,242 @@
+#pragma once
+
+// Counts heap allocations per thread by replacing the global allocation
+// functions. Include from exactly one translation unit per executable: the
+// replacements below are definitions, not declarations.
+//
+// With glibc the malloc family itself is interposed, so allocations made by
+// libraries (and by operator new, which sits on malloc) are seen too.
+// Elsewhere only operator new is counted.
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#if defined(__GLIBC__) && !defined(ALLOC_COUNTER_NO_MALLOC_HOOK)
+#define ALLOC_COUNTER_MALLOC_HOOK 1
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+}
+#endif
+
+struct AllocStats {
+  uint64_t allocations;
+  uint64_t deallocations;
+  uint64_t bytes;
+};
+
+// Constant initialized, so touching it from inside malloc never allocates
+inline thread_local AllocStats tls_alloc_stats = {0, 0, 0};
+
+[[gnu::always_inline]] inline void count_allocation(size_t size) {
+  ++tls_alloc_stats.allocations;
+  tls_alloc_stats.bytes += size;
+}
+
+[[gnu::always_inline]] inline void count_deallocation(void* ptr) {
+  if (ptr) ++tls_alloc_stats.deallocations;
+}
+
+// Allocation statistics of the calling thread since the program started
+[[nodiscard]] inline AllocStats thread_alloc_stats() {
+  return tls_alloc_stats;
+}
+
+#ifdef ALLOC_COUNTER_MALLOC_HOOK
+extern "C" {
+void* malloc(size_t size) noexcept {
+  count_allocation(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+  count_allocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+  count_allocation(size);
+  if (ptr) count_deallocation(ptr);
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) noexcept {
+  count_deallocation(ptr);
+  __libc_free(ptr);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+  count_allocation(size);
+  return __libc_memalign(alignment, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+  count_allocation(size);
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) noexcept {
+  count_allocation(size);
+  void* ptr = __libc_memalign(alignment, size);
+  if (!ptr) return ENOMEM;
+  *out = ptr;
+  return 0;
+}
+}
+#endif
+
+namespace alloc_counter_detail {
+
+inline void* allocate(size_t size) {
+#ifndef ALLOC_COUNTER_MALLOC_HOOK
+  count_allocation(size);
+#endif
+  return std::malloc(size ? size : 1);
+}
+
+inline void* allocate_aligned(size_t size, std::align_val_t alignment) {
+#ifndef ALLOC_COUNTER_MALLOC_HOOK
+  count_allocation(size);
+#endif
+  const size_t align = static_cast<size_t>(alignment);
+  // aligned_alloc wants the size rounded to the alignment
+  return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+inline void deallocate(void* ptr) {
+#ifndef ALLOC_COUNTER_MALLOC_HOOK
+  count_deallocation(ptr);
+#endif
+  std::free(ptr);
+}
+
+}  // namespace alloc_counter_detail
+
+void* operator new(size_t size) {
+  if (void* ptr = alloc_counter_detail::allocate(size)) return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) { return ::operator new(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return alloc_counter_detail::allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return alloc_counter_detail::allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  if (void* ptr = alloc_counter_detail::allocate_aligned(size, alignment)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return ::operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+  alloc_counter_detail::deallocate(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+  alloc_counter_detail::deallocate(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+  alloc_counter_detail::deallocate(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+  alloc_counter_detail::deallocate(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  alloc_counter_detail::deallocate(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  alloc_counter_detail::deallocate(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  alloc_counter_detail::deallocate(ptr);
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+  alloc_counter_detail::deallocate(ptr);
+}
+
+// Benchmarks that must not touch the heap inside their measured loop
+enum class AllocPolicy { Report, HotPath };
+
+// Reports heap allocations made by the benchmark thread between
+// construction and stop() (or destruction) as per-iteration counters.
+// Declare it right before the measured loop; allocations between pause()
+// and resume(), such as untimed setup, are left out. In strict mode
+// (BENCH_ALLOC_STRICT=1 in the environment) a HotPath benchmark that
+// allocates is failed.
+template <typename State>
+class AllocScope {
+ public:
+  explicit AllocScope(State& state, AllocPolicy policy = AllocPolicy::Report)
+      : state_(state), policy_(policy), start_(thread_alloc_stats()) {}
+
+  ~AllocScope() { stop(); }
+
+  void pause() { paused_at_ = thread_alloc_stats(); }
+
+  void resume() {
+    const AllocStats now = thread_alloc_stats();
+    excluded_.allocations += now.allocations - paused_at_.allocations;
+    excluded_.bytes += now.bytes - paused_at_.bytes;
+  }
+
+  // End the measurement before any work that follows the loop, such as
+  // setting other counters
+  void stop() {
+    if (stopped_) return;
+    stopped_ = true;
+    const AllocStats end = thread_alloc_stats();
+    if (state_.iterations() == 0) return;
+
+    using Counter = typename std::remove_reference_t<
+        decltype(state_.counters)>::mapped_type;
+    const uint64_t allocations =
+        end.allocations - start_.allocations - excluded_.allocations;
+    state_.counters["allocs"] =
+        Counter(static_cast<double>(allocations), Counter::kAvgIterations);
+    state_.counters["alloc_bytes"] =
+        Counter(static_cast<double>(end.bytes - start_.bytes - excluded_.bytes),
+                Counter::kAvgIterations);
+
+    if (policy_ == AllocPolicy::HotPath && allocations > 0 && strict()) {
+      // Built before SkipWithError so the message itself is not counted
+      const std::string message = "hot path allocated " +
+                                  std::to_string(allocations) + " times in " +
+                                  std::to_string(state_.iterations()) +
+                                  " iterations";
+      state_.SkipWithError(message.c_str());
+    }
+  }
+
+  static bool strict() {
+    static const bool strict = [] {
+      const char* value = std::getenv("BENCH_ALLOC_STRICT");
+      return value && value[0] != '\0' && value[0] != '0';
+    }();
+    return strict;
+  }
+
+ private:
+  State& state_;
+  AllocPolicy policy_;
+  AllocStats start_;
+  AllocStats paused_at_ = {0, 0, 0};
+  AllocStats excluded_ = {0, 0, 0};
+  bool stopped_ = false;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CACHE_CONTROL_X86 1
+#endif
+
+#ifdef __linux__
+// Linker-provided bounds of the executable's text
+extern "C" const char __executable_start[];
+extern "C" const char etext[];
+#endif
+
+// Cache state before a single-shot measurement. In production the
+// serializer runs after idle gaps or after the strategy has been through
+// L1/L2, so warm loops flatter it.
+enum class CacheMode : uint8_t {
+  Warm,      // nothing between shots
+  Polluted,  // L1 and L2 overwritten with unrelated dirty lines
+  Cold       // data pushed out to memory and code lines flushed
+};
+
+inline constexpr const char* CACHE_MODE_NAMES[] = {"warm", "polluted", "cold"};
+
+// Puts the caches in a CacheMode between shots. Pollution writes one byte
+// per line of a private buffer, twice the size of the cache level being
+// evicted, with a stride the prefetchers cannot skip ahead of.
+class CacheThrasher {
+ public:
+  static constexpr size_t LINE = 64;
+  // Cap for the cold buffer; some machines report the whole socket's LLC
+  static constexpr size_t MAX_COLD_BYTES = 64 * 1024 * 1024;
+
+  explicit CacheThrasher(CacheMode mode) : mode_(mode) {
+    switch (mode) {
+      case CacheMode::Warm:
+        size_ = 0;
+        break;
+      case CacheMode::Polluted:
+        size_ = 2 * cache_size(_SC_LEVEL2_CACHE_SIZE, 1024 * 1024);
+        break;
+      case CacheMode::Cold:
+        size_ = std::min(2 * cache_size(_SC_LEVEL3_CACHE_SIZE, 32 * 1024 * 1024),
+                         MAX_COLD_BYTES);
+        break;
+    }
+    if (size_ > 0) {
+      buffer_ = std::make_unique<uint8_t[]>(size_);
+      std::fill_n(buffer_.get(), size_, 0);
+    }
+  }
+
+  [[nodiscard]] CacheMode mode() const { return mode_; }
+  [[nodiscard]] size_t size() const { return size_; }
+
+  // Call between shots, outside the timed region
+  void apply() {
+    if (mode_ == CacheMode::Warm) return;
+    pollute();
+    if (mode_ == CacheMode::Cold) flush_code();
+  }
+
+  // Evict [data, data + size) from every cache level
+  static void flush(const void* data, size_t size) {
+#ifdef CACHE_CONTROL_X86
+    const auto* p = reinterpret_cast<const char*>(
+        reinterpret_cast<uintptr_t>(data) & ~(LINE - 1));
+    const auto* end = static_cast<const char*>(data) + size;
+    for (; p < end; p += LINE) _mm_clflush(p);
+    _mm_mfence();
+#else
+    (void)data;
+    (void)size;
+#endif
+  }
+
+ private:
+  static size_t cache_size(int name, size_t fallback) {
+    const long size = ::sysconf(name);
+    return size > 0 ? static_cast<size_t>(size) : fallback;
+  }
+
+  void pollute() {
+    // Visit lines in a scrambled order: 4099 lines is larger than any
+    // prefetcher's window, and prime, so every line is visited once unless
+    // the line count is a multiple of it. The modulo also keeps a buffer
+    // smaller than one step (an L2 of 128 KiB or less) in range.
+    static constexpr size_t STEP = 4099;
+    const size_t lines = size_ / LINE;
+    size_t line = 0;
+    for (size_t i = 0; i < lines; ++i) {
+      buffer_[line * LINE] += 1;
+      line = (line + STEP) % lines;
+    }
+    asm volatile("" : : "r"(buffer_.get()) : "memory");
+  }
+
+  // Everything from the start of the executable to the end of its text
+  // segment, so the serializer's instructions come from memory
+  static void flush_code() {
+#if defined(__linux__) && defined(CACHE_CONTROL_X86)
+    flush(__executable_start, static_cast<size_t>(etext - __executable_start));
+#endif
+  }
+
+  CacheMode mode_;
+  size_t size_;
+  std::unique_ptr<uint8_t[]> buffer_;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+
+// Version-neutral order payloads. Every serializer generation is driven
+// with the same values through the adapters in unified_adapters.h, so
+// their numbers can be compared directly.
+namespace canonical {
+
+struct Place {
+  std::string instrument_name;
+  double amount;
+  double price;
+  std::string type;
+  std::string label;
+  bool reduce_only;
+  bool post_only;
+  std::string time_in_force;
+  double max_show;
+};
+
+struct Edit {
+  std::string order_id;
+  double amount;
+  double price;
+  bool post_only;
+  double max_show;
+};
+
+struct Cancel {
+  std::string order_id;
+};
+
+// Prices and sizes are exact in binary, so every generation writes the
+// same values back
+inline Place place() {
+  return Place{.instrument_name = "BTC-PERPETUAL",
+               .amount = 100.0,
+               .price = 40000.5,
+               .type = "limit",
+               .label = "test_order",
+               .reduce_only = false,
+               .post_only = true,
+               .time_in_force = "good_til_cancelled",
+               .max_show = 100.0};
+}
+
+inline Edit edit() {
+  return Edit{.order_id = "1234567890abcdef",
+              .amount = 150.0,
+              .price = 40500.5,
+              .post_only = true,
+              .max_show = 150.0};
+}
+
+inline Cancel cancel() { return Cancel{.order_id = "1234567890abcdef"}; }
+
+namespace fields {
+inline constexpr char INSTRUMENT_NAME[] = "instrument_name";
+inline constexpr char AMOUNT[] = "amount";
+inline constexpr char PRICE[] = "price";
+inline constexpr char TYPE[] = "type";
+inline constexpr char LABEL[] = "label";
+inline constexpr char ORDER_ID[] = "order_id";
+inline constexpr char REDUCE_ONLY[] = "reduce_only";
+inline constexpr char POST_ONLY[] = "post_only";
+inline constexpr char TIME_IN_FORCE[] = "time_in_force";
+inline constexpr char MAX_SHOW[] = "max_show";
+}  // namespace fields
+
+}  // namespace canonical
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <thread>
+
+// Pin the calling thread to one CPU. cpu wraps around the CPUs the machine
+// has, so a run with more threads than CPUs still starts. Call it first
+// thing in a worker, before it touches its state or waits on a start
+// barrier, so no measured work runs on the CPU it was spawned on.
+inline void pin_to_cpu(unsigned cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu % std::max(1u, std::thread::hardware_concurrency()), &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
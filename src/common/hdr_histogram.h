@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+
+// Fixed-memory log-linear histogram in the style of HdrHistogram. Values
+// below 2^SubBucketBits are counted exactly; above that every power of two
+// range is split into 2^(SubBucketBits - 1) linear sub-buckets, which keeps
+// the relative error under 2^-(SubBucketBits - 1). Values of 2^MaxValueBits
+// and above are clamped into the last bucket. Recording never allocates.
+template <unsigned SubBucketBits = 8, unsigned MaxValueBits = 40>
+class HdrHistogram {
+  static_assert(SubBucketBits >= 2 && SubBucketBits < MaxValueBits);
+  static_assert(MaxValueBits <= 63);
+
+ public:
+  static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t{1} << SubBucketBits;
+  static constexpr uint64_t HALF_COUNT = SUB_BUCKET_COUNT / 2;
+  static constexpr size_t BUCKET_COUNT =
+      SUB_BUCKET_COUNT + (MaxValueBits - SubBucketBits) * HALF_COUNT;
+  static constexpr uint64_t MAX_VALUE = (uint64_t{1} << MaxValueBits) - 1;
+
+  [[gnu::always_inline]] inline void record(uint64_t value,
+                                            uint64_t count = 1) {
+    value = std::min(value, MAX_VALUE);
+    counts_[index_of(value)] += count;
+    total_ += count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  // Add every count of other; both sides share the same layout
+  void merge(const HdrHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) counts_[i] += other.counts_[i];
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  void reset() {
+    counts_.fill(0);
+    total_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+  }
+
+  // Highest value equivalent to the sample at percentile p (0 to 100),
+  // capped at the largest value recorded
+  [[nodiscard]] uint64_t percentile(double p) const {
+    if (total_ == 0) return 0;
+    p = std::clamp(p, 0.0, 100.0);
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * total_ + 0.5);
+    rank = std::clamp<uint64_t>(rank, 1, total_);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) return std::min(highest_equivalent(i), max_);
+    }
+    return max_;
+  }
+
+  [[nodiscard]] double mean() const {
+    if (total_ == 0) return 0.0;
+    double sum = 0.0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+      if (counts_[i] == 0) continue;
+      const double mid =
+          (lowest_equivalent(i) + highest_equivalent(i)) / 2.0;
+      sum += mid * counts_[i];
+    }
+    return sum / total_;
+  }
+
+  [[nodiscard]] uint64_t count() const { return total_; }
+  [[nodiscard]] uint64_t min() const { return total_ ? min_ : 0; }
+  [[nodiscard]] uint64_t max() const { return max_; }
+
+  [[gnu::always_inline]] static constexpr size_t index_of(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) return static_cast<size_t>(value);
+    // Keep the top SubBucketBits bits of value; the shift selects the
+    // power of two range
+    const unsigned shift =
+        std::bit_width(value) - SubBucketBits;  // >= 1
+    const uint64_t top = value >> shift;        // [HALF_COUNT, SUB_BUCKET_COUNT)
+    return static_cast<size_t>(SUB_BUCKET_COUNT + (shift - 1) * HALF_COUNT +
+                               (top - HALF_COUNT));
+  }
+
+  static constexpr uint64_t lowest_equivalent(size_t index) {
+    if (index < SUB_BUCKET_COUNT) return index;
+    const uint64_t offset = index - SUB_BUCKET_COUNT;
+    const unsigned shift = static_cast<unsigned>(offset / HALF_COUNT) + 1;
+    const uint64_t top = HALF_COUNT + offset % HALF_COUNT;
+    return top << shift;
+  }
+
+  static constexpr uint64_t highest_equivalent(size_t index) {
+    if (index < SUB_BUCKET_COUNT) return index;
+    const unsigned shift =
+        static_cast<unsigned>((index - SUB_BUCKET_COUNT) / HALF_COUNT) + 1;
+    return lowest_equivalent(index) + (uint64_t{1} << shift) - 1;
+  }
+
+ private:
+  std::array<uint64_t, BUCKET_COUNT> counts_{};
+  uint64_t total_ = 0;
+  uint64_t min_ = UINT64_MAX;
+  uint64_t max_ = 0;
+};
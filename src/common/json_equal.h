@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Parsed JSON value, just enough to compare serializer output by meaning:
+// object key order and number spelling (100 vs 100.0) do not matter.
+struct JsonValue {
+  enum class Kind { Null, Bool, Number, String, Array, Object };
+
+  Kind kind = Kind::Null;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::map<std::string, JsonValue, std::less<>> object;
+
+  bool operator==(const JsonValue& other) const {
+    if (kind != other.kind) return false;
+    switch (kind) {
+      case Kind::Null:
+        return true;
+      case Kind::Bool:
+        return boolean == other.boolean;
+      case Kind::Number:
+        return number == other.number;
+      case Kind::String:
+        return string == other.string;
+      case Kind::Array:
+        return array == other.array;
+      case Kind::Object:
+        return object == other.object;
+    }
+    return false;
+  }
+};
+
+class JsonParser {
+ public:
+  // False if text is not one complete JSON value
+  static bool parse(std::string_view text, JsonValue& out) {
+    JsonParser parser(text);
+    if (!parser.value(out)) return false;
+    parser.skip_ws();
+    return parser.pos_ == text.size();
+  }
+
+ private:
+  explicit JsonParser(std::string_view text) : text_(text), pos_(0) {}
+
+  void skip_ws() {
+    while (pos_ < text_.size() &&
+           (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' ||
+            text_[pos_] == '\r')) {
+      ++pos_;
+    }
+  }
+
+  bool consume(char c) {
+    skip_ws();
+    if (pos_ < text_.size() && text_[pos_] == c) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  bool literal(std::string_view word) {
+    if (text_.substr(pos_, word.size()) != word) return false;
+    pos_ += word.size();
+    return true;
+  }
+
+  bool value(JsonValue& out) {
+    skip_ws();
+    if (pos_ >= text_.size()) return false;
+    switch (text_[pos_]) {
+      case '{':
+        return object(out);
+      case '[':
+        return array(out);
+      case '"':
+        out.kind = JsonValue::Kind::String;
+        return string(out.string);
+      case 't':
+        out.kind = JsonValue::Kind::Bool;
+        out.boolean = true;
+        return literal("true");
+      case 'f':
+        out.kind = JsonValue::Kind::Bool;
+        out.boolean = false;
+        return literal("false");
+      case 'n':
+        out.kind = JsonValue::Kind::Null;
+        return literal("null");
+      default:
+        return number(out);
+    }
+  }
+
+  bool object(JsonValue& out) {
+    out.kind = JsonValue::Kind::Object;
+    ++pos_;
+    if (consume('}')) return true;
+    do {
+      skip_ws();
+      std::string key;
+      if (!string(key) || !consume(':')) return false;
+      JsonValue member;
+      if (!value(member)) return false;
+      // Duplicate keys make the output ambiguous; treat as malformed
+      if (!out.object.emplace(std::move(key), std::move(member)).second) {
+        return false;
+      }
+    } while (consume(','));
+    return consume('}');
+  }
+
+  bool array(JsonValue& out) {
+    out.kind = JsonValue::Kind::Array;
+    ++pos_;
+    if (consume(']')) return true;
+    do {
+      out.array.emplace_back();
+      if (!value(out.array.back())) return false;
+    } while (consume(','));
+    return consume(']');
+  }
+
+  bool string(std::string& out) {
+    if (pos_ >= text_.size() || text_[pos_] != '"') return false;
+    ++pos_;
+    while (pos_ < text_.size()) {
+      const char c = text_[pos_++];
+      if (c == '"') return true;
+      if (c != '\\') {
+        out.push_back(c);
+        continue;
+      }
+      if (pos_ >= text_.size()) return false;
+      switch (text_[pos_++]) {
+        case '"': out.push_back('"'); break;
+        case '\\': out.push_back('\\'); break;
+        case '/': out.push_back('/'); break;
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u': {
+          // Kept escaped; only equality matters here
+          if (pos_ + 4 > text_.size()) return false;
+          out.append("\\u");
+          out.append(text_.substr(pos_, 4));
+          pos_ += 4;
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+    return false;
+  }
+
+  bool number(JsonValue& out) {
+    const size_t start = pos_;
+    while (pos_ < text_.size() &&
+           std::string_view("+-0123456789.eE").find(text_[pos_]) !=
+               std::string_view::npos) {
+      ++pos_;
+    }
+    if (pos_ == start) return false;
+    const std::string token(text_.substr(start, pos_ - start));
+    char* end = nullptr;
+    out.kind = JsonValue::Kind::Number;
+    out.number = std::strtod(token.c_str(), &end);
+    return end == token.c_str() + token.size();
+  }
+
+  std::string_view text_;
+  size_t pos_;
+};
+
+// Both sides parse and mean the same thing
+inline bool json_equal(std::string_view a, std::string_view b) {
+  JsonValue left;
+  JsonValue right;
+  return JsonParser::parse(a, left) && JsonParser::parse(b, right) &&
+         left == right;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "hdr_histogram.h"
+#include "tsc_clock.h"
+
+// Latency samples in nanoseconds, timed with the TSC and counted in a
+// fixed-memory histogram. One recorder per thread; merge them afterwards.
+//
+//   LatencyRecorder recorder;
+//   for (...) {
+//     const uint64_t t0 = recorder.start();
+//     work();
+//     recorder.stop(t0);
+//   }
+//   recorder.report_to(state);
+class LatencyRecorder {
+ public:
+  using Histogram = HdrHistogram<>;
+
+  LatencyRecorder() : calibration_(TscClock::calibration()) {}
+
+  [[nodiscard, gnu::always_inline]] inline uint64_t start() const {
+    return TscClock::start();
+  }
+
+  [[gnu::always_inline]] inline void stop(uint64_t start_ticks) {
+    const uint64_t end = TscClock::stop();
+    histogram_.record(calibration_.to_ns(end - start_ticks));
+  }
+
+  // Record a latency measured elsewhere, e.g. a queueing delay from two
+  // TscClock::now_ns() timestamps
+  [[gnu::always_inline]] inline void record_ns(int64_t ns) {
+    histogram_.record(ns > 0 ? static_cast<uint64_t>(ns) : 0);
+  }
+
+  void merge(const LatencyRecorder& other) {
+    histogram_.merge(other.histogram_);
+  }
+
+  void reset() { histogram_.reset(); }
+
+  [[nodiscard]] uint64_t percentile_ns(double p) const {
+    return histogram_.percentile(p);
+  }
+
+  [[nodiscard]] const Histogram& histogram() const { return histogram_; }
+  [[nodiscard]] uint64_t count() const { return histogram_.count(); }
+
+  // Percentile counters (p50_ns ... max_ns) on a benchmark::State or
+  // anything else with a string keyed counters map
+  template <typename State>
+  void report_to(State& state, const std::string& prefix = "") const {
+    state.counters[prefix + "p50_ns"] = histogram_.percentile(50.0);
+    state.counters[prefix + "p90_ns"] = histogram_.percentile(90.0);
+    state.counters[prefix + "p99_ns"] = histogram_.percentile(99.0);
+    state.counters[prefix + "p999_ns"] = histogram_.percentile(99.9);
+    state.counters[prefix + "max_ns"] = histogram_.max();
+  }
+
+ private:
+  TscCalibration calibration_;
+  Histogram histogram_;
+};
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "canonical.h"
+#include "workload.h"
+
+// Compact binary log of order intents for capture and replay.
+//
+// File:    "OLOG" u16 version u16 reserved, then records back to back
+// Record:  u16 size of the rest, u8 kind, u8 flags, u64 timestamp_ns, then
+//          by kind
+//   place  f64 amount, f64 price, f64 max_show,
+//          str instrument_name, str type, str label, str time_in_force
+//   edit   f64 amount, f64 price, f64 max_show, str order_id
+//   cancel str order_id
+// str is a u8 length and the bytes. Numbers are in host byte order; logs
+// are meant to be replayed on the kind of machine that captured them.
+namespace order_log {
+
+inline constexpr char MAGIC[4] = {'O', 'L', 'O', 'G'};
+inline constexpr uint16_t VERSION = 2;
+inline constexpr size_t HEADER_SIZE = 8;
+inline constexpr size_t MAX_STRING = 255;
+// Size prefix, kind, flags, timestamp, three numbers and four strings
+inline constexpr size_t MAX_RECORD = 2 + 1 + 1 + 8 + 3 * 8 +
+                                     4 * (1 + MAX_STRING);
+
+enum Flags : uint8_t {
+  REDUCE_ONLY = 1 << 0,
+  POST_ONLY = 1 << 1,
+};
+
+}  // namespace order_log
+
+// A loaded log: the messages in the same shape WorkloadGenerator produces,
+// plus the capture time of every event
+struct OrderLog {
+  WorkloadStream stream;
+  std::vector<uint64_t> timestamps_ns;  // parallel to stream.events
+  uint64_t dropped_records = 0;         // malformed or truncated
+  uint64_t first_dropped_offset = 0;    // file offset of the first of them
+};
+
+// Appends records to an in-memory block. Full blocks go to a writer thread
+// that owns the file, so the recording thread does no file I/O: it pays a
+// few copies per record and a lock and wake-up per 64 KiB block. A record
+// with a string longer than 255 bytes is refused and counted in
+// rejected(); a block that cannot be written is counted in
+// failed_writes().
+class OrderLogWriter {
+ public:
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+  static constexpr size_t SPARE_BLOCKS = 4;
+
+  OrderLogWriter() {
+    block_.reserve(BLOCK_SIZE + order_log::MAX_RECORD);
+    spare_.resize(SPARE_BLOCKS);
+    for (auto& block : spare_) {
+      block.reserve(BLOCK_SIZE + order_log::MAX_RECORD);
+    }
+  }
+  ~OrderLogWriter() { close(); }
+
+  OrderLogWriter(const OrderLogWriter&) = delete;
+  OrderLogWriter& operator=(const OrderLogWriter&) = delete;
+
+  bool open(const char* path) {
+    close();
+    file_ = std::fopen(path, "wb");
+    if (!file_) return false;
+    char header[order_log::HEADER_SIZE] = {};
+    std::memcpy(header, order_log::MAGIC, sizeof(order_log::MAGIC));
+    std::memcpy(header + 4, &order_log::VERSION, sizeof(order_log::VERSION));
+    if (std::fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+      std::fclose(file_);
+      file_ = nullptr;
+      return false;
+    }
+    stopping_ = false;
+    failed_writes_ = 0;
+    lost_bytes_ = 0;
+    thread_ = std::thread([this] { run(); });
+    return true;
+  }
+
+  bool record(const canonical::Place& p, uint64_t timestamp_ns) {
+    if (!fits(p.instrument_name) || !fits(p.type) || !fits(p.label) ||
+        !fits(p.time_in_force)) {
+      return reject();
+    }
+    begin(WorkloadKind::Place,
+          (p.reduce_only ? order_log::REDUCE_ONLY : 0) |
+              (p.post_only ? order_log::POST_ONLY : 0),
+          timestamp_ns);
+    put(p.amount);
+    put(p.price);
+    put(p.max_show);
+    put(p.instrument_name);
+    put(p.type);
+    put(p.label);
+    put(p.time_in_force);
+    end();
+    return true;
+  }
+
+  bool record(const canonical::Edit& e, uint64_t timestamp_ns) {
+    if (!fits(e.order_id)) return reject();
+    begin(WorkloadKind::Edit, e.post_only ? order_log::POST_ONLY : 0,
+          timestamp_ns);
+    put(e.amount);
+    put(e.price);
+    put(e.max_show);
+    put(e.order_id);
+    end();
+    return true;
+  }
+
+  bool record(const canonical::Cancel& c, uint64_t timestamp_ns) {
+    if (!fits(c.order_id)) return reject();
+    begin(WorkloadKind::Cancel, 0, timestamp_ns);
+    put(c.order_id);
+    end();
+    return true;
+  }
+
+  // Hand over the current block and wait until the writer thread has
+  // written everything; false if any block failed since open()
+  bool flush() {
+    if (!file_) return true;
+    hand_off();
+    std::unique_lock lock(mutex_);
+    drained_.wait(lock, [&] { return full_.empty() && !busy_; });
+    return failed_writes_ == 0;
+  }
+
+  bool close() {
+    if (!file_) return true;
+    bool ok = flush();
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    ready_.notify_one();
+    thread_.join();
+    ok &= std::fclose(file_) == 0;
+    file_ = nullptr;
+    return ok;
+  }
+
+  [[nodiscard]] uint64_t records() const { return records_; }
+  [[nodiscard]] uint64_t rejected() const { return rejected_; }
+
+  // Blocks the writer thread could not write, and the bytes in them
+  [[nodiscard]] uint64_t failed_writes() const {
+    std::lock_guard lock(mutex_);
+    return failed_writes_;
+  }
+  [[nodiscard]] uint64_t lost_bytes() const {
+    std::lock_guard lock(mutex_);
+    return lost_bytes_;
+  }
+
+ private:
+  static bool fits(std::string_view s) {
+    return s.size() <= order_log::MAX_STRING;
+  }
+
+  bool reject() {
+    ++rejected_;
+    return false;
+  }
+
+  void begin(WorkloadKind kind, int flags, uint64_t timestamp_ns) {
+    record_start_ = block_.size();
+    put(uint16_t{0});  // size, filled in by end()
+    block_.push_back(static_cast<char>(kind));
+    block_.push_back(static_cast<char>(flags));
+    put(timestamp_ns);
+  }
+
+  void end() {
+    const auto size =
+        static_cast<uint16_t>(block_.size() - record_start_ - sizeof(uint16_t));
+    std::memcpy(block_.data() + record_start_, &size, sizeof(size));
+    ++records_;
+    if (block_.size() >= BLOCK_SIZE && file_) hand_off();
+  }
+
+  template <typename T>
+  void put(T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    block_.insert(block_.end(), bytes, bytes + sizeof(T));
+  }
+
+  // Length already checked by fits()
+  void put(std::string_view s) {
+    block_.push_back(static_cast<char>(s.size()));
+    block_.insert(block_.end(), s.data(), s.data() + s.size());
+  }
+
+  void put(const std::string& s) { put(std::string_view(s)); }
+
+  // Queue the current block for the writer thread and continue in a spare
+  // one; a new block is allocated only when the writer is SPARE_BLOCKS
+  // behind
+  void hand_off() {
+    if (block_.empty()) return;
+    std::vector<char> next;
+    {
+      std::lock_guard lock(mutex_);
+      full_.push_back(std::move(block_));
+      if (!spare_.empty()) {
+        next = std::move(spare_.back());
+        spare_.pop_back();
+      }
+    }
+    ready_.notify_one();
+    if (next.capacity() == 0) {
+      next.reserve(BLOCK_SIZE + order_log::MAX_RECORD);
+    }
+    block_ = std::move(next);
+  }
+
+  // Writer thread
+  void run() {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+      ready_.wait(lock, [&] { return stopping_ || !full_.empty(); });
+      if (full_.empty()) return;
+      std::vector<char> block = std::move(full_.front());
+      full_.pop_front();
+      busy_ = true;
+      lock.unlock();
+
+      const bool ok =
+          std::fwrite(block.data(), 1, block.size(), file_) == block.size() &&
+          std::fflush(file_) == 0;
+
+      lock.lock();
+      if (!ok) {
+        ++failed_writes_;
+        lost_bytes_ += block.size();
+      }
+      block.clear();
+      spare_.push_back(std::move(block));
+      busy_ = false;
+      if (full_.empty()) drained_.notify_all();
+    }
+  }
+
+  std::FILE* file_ = nullptr;
+  std::vector<char> block_;
+  size_t record_start_ = 0;
+  uint64_t records_ = 0;
+  uint64_t rejected_ = 0;
+
+  // Shared with the writer thread
+  mutable std::mutex mutex_;
+  std::condition_variable ready_;
+  std::condition_variable drained_;
+  std::deque<std::vector<char>> full_;
+  std::vector<std::vector<char>> spare_;
+  bool busy_ = false;
+  bool stopping_ = false;
+  uint64_t failed_writes_ = 0;
+  uint64_t lost_bytes_ = 0;
+  std::thread thread_;
+};
+
+// Reads a whole log into memory. Every record carries its size, so a
+// malformed one is skipped and the rest still load; skipped records and a
+// truncated final record (e.g. from a process that died mid-write) are
+// counted in OrderLog::dropped_records, with the offset of the first. A
+// file that is not a log of this version fails the load and is described
+// in *error.
+class OrderLogReader {
+ public:
+  static std::optional<OrderLog> load(const char* path, std::string* error) {
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+      *error = std::string("cannot open ") + path + ": " + std::strerror(errno);
+      return std::nullopt;
+    }
+    std::vector<char> data;
+    char chunk[65536];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+      data.insert(data.end(), chunk, chunk + n);
+    }
+    std::fclose(file);
+    return parse(std::string_view(data.data(), data.size()), error);
+  }
+
+  static std::optional<OrderLog> parse(std::string_view data,
+                                       std::string* error) {
+    uint16_t version = 0;
+    if (data.size() < order_log::HEADER_SIZE ||
+        std::memcmp(data.data(), order_log::MAGIC, 4) != 0) {
+      *error = "not an order log";
+      return std::nullopt;
+    }
+    std::memcpy(&version, data.data() + 4, sizeof(version));
+    if (version != order_log::VERSION) {
+      *error = "unsupported order log version " + std::to_string(version);
+      return std::nullopt;
+    }
+
+    OrderLog log;
+    Cursor in{data.substr(order_log::HEADER_SIZE)};
+    while (!in.rest.empty()) {
+      const uint64_t offset = data.size() - in.rest.size();
+      uint16_t size;
+      if (!in.get(size) || in.rest.size() < size) {
+        drop(log, offset);  // truncated tail
+        break;
+      }
+      Cursor record{in.rest.substr(0, size)};
+      in.rest.remove_prefix(size);
+      if (!read_record(record, log)) drop(log, offset);
+    }
+    return log;
+  }
+
+ private:
+  struct Cursor {
+    std::string_view rest;
+
+    template <typename T>
+    bool get(T& value) {
+      if (rest.size() < sizeof(T)) return false;
+      std::memcpy(&value, rest.data(), sizeof(T));
+      rest.remove_prefix(sizeof(T));
+      return true;
+    }
+
+    bool get(std::string& value) {
+      uint8_t len;
+      if (!get(len) || rest.size() < len) return false;
+      value.assign(rest.data(), len);
+      rest.remove_prefix(len);
+      return true;
+    }
+  };
+
+  static void drop(OrderLog& log, uint64_t offset) {
+    if (log.dropped_records++ == 0) log.first_dropped_offset = offset;
+  }
+
+  // Appends one record to log; false if it is malformed or does not fill
+  // exactly its size
+  static bool read_record(Cursor& in, OrderLog& log) {
+    uint8_t kind, flags;
+    uint64_t timestamp;
+    if (!in.get(kind) || !in.get(flags) || !in.get(timestamp)) return false;
+
+    WorkloadEvent event{};
+    switch (static_cast<WorkloadKind>(kind)) {
+      case WorkloadKind::Place: {
+        canonical::Place p{};
+        if (!(in.get(p.amount) && in.get(p.price) && in.get(p.max_show) &&
+              in.get(p.instrument_name) && in.get(p.type) &&
+              in.get(p.label) && in.get(p.time_in_force)) ||
+            !in.rest.empty()) {
+          return false;
+        }
+        p.reduce_only = flags & order_log::REDUCE_ONLY;
+        p.post_only = flags & order_log::POST_ONLY;
+        event = {WorkloadKind::Place,
+                 static_cast<uint32_t>(log.stream.places.size())};
+        log.stream.places.push_back(std::move(p));
+        break;
+      }
+      case WorkloadKind::Edit: {
+        canonical::Edit e{};
+        if (!(in.get(e.amount) && in.get(e.price) && in.get(e.max_show) &&
+              in.get(e.order_id)) ||
+            !in.rest.empty()) {
+          return false;
+        }
+        e.post_only = flags & order_log::POST_ONLY;
+        event = {WorkloadKind::Edit,
+                 static_cast<uint32_t>(log.stream.edits.size())};
+        log.stream.edits.push_back(std::move(e));
+        break;
+      }
+      case WorkloadKind::Cancel: {
+        canonical::Cancel c{};
+        if (!in.get(c.order_id) || !in.rest.empty()) return false;
+        event = {WorkloadKind::Cancel,
+                 static_cast<uint32_t>(log.stream.cancels.size())};
+        log.stream.cancels.push_back(std::move(c));
+        break;
+      }
+      default:
+        return false;
+    }
+    log.stream.events.push_back(event);
+    log.timestamps_ns.push_back(timestamp);
+    return true;
+  }
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PERF_COUNTERS_LINUX 1
+#endif
+
+// Hardware counters for the calling thread, user space only. Each event is
+// opened on its own so one the PMU does not offer (common in VMs) is simply
+// missing. When perf access is denied nothing opens and every read is
+// absent.
+class PerfCounters {
+ public:
+  enum Event { Cycles, Instructions, BranchMisses, L1dMisses, LlcMisses };
+  static constexpr int EVENT_COUNT = 5;
+  static constexpr const char* NAMES[EVENT_COUNT] = {
+      "cycles", "instructions", "branch_misses", "L1d_misses", "LLC_misses"};
+
+  PerfCounters() {
+    for (int& fd : fds_) fd = -1;
+#ifdef PERF_COUNTERS_LINUX
+    if (!unavailable()) {
+      const uint64_t l1d_read_miss =
+          PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      fds_[Cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+      // Denied, or no PMU at all: later scopes skip the syscalls
+      if (fds_[Cycles] < 0 && (errno == EACCES || errno == EPERM ||
+                               errno == ENOSYS || errno == ENOENT ||
+                               errno == ENODEV)) {
+        unavailable() = true;
+        return;
+      }
+      fds_[Instructions] =
+          open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+      fds_[BranchMisses] =
+          open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+      fds_[L1dMisses] = open(PERF_TYPE_HW_CACHE, l1d_read_miss);
+      fds_[LlcMisses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    }
+#endif
+  }
+
+  ~PerfCounters() {
+#ifdef PERF_COUNTERS_LINUX
+    for (int fd : fds_) {
+      if (fd >= 0) ::close(fd);
+    }
+#endif
+  }
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  void start() {
+#ifdef PERF_COUNTERS_LINUX
+    for (int fd : fds_) {
+      if (fd < 0) continue;
+      ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  void stop() {
+#ifdef PERF_COUNTERS_LINUX
+    for (int fd : fds_) {
+      if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif
+  }
+
+  // Carry on counting after stop(), keeping the counts so far
+  void resume() {
+#ifdef PERF_COUNTERS_LINUX
+    for (int fd : fds_) {
+      if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  [[nodiscard]] bool available(Event event) const { return fds_[event] >= 0; }
+
+  // Count since start(), scaled up if the kernel had to multiplex the
+  // event; false when the event is not available
+  bool read(Event event, double& value) const {
+#ifdef PERF_COUNTERS_LINUX
+    if (fds_[event] < 0) return false;
+    uint64_t data[3];  // value, time enabled, time running
+    if (::read(fds_[event], data, sizeof(data)) != sizeof(data)) return false;
+    if (data[2] == 0) return false;
+    value = static_cast<double>(data[0]);
+    if (data[2] < data[1]) {
+      value *= static_cast<double>(data[1]) / static_cast<double>(data[2]);
+    }
+    return true;
+#else
+    (void)event;
+    (void)value;
+    return false;
+#endif
+  }
+
+ private:
+#ifdef PERF_COUNTERS_LINUX
+  static int open(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(
+        ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+#endif
+
+  static bool& unavailable() {
+    static bool unavailable = false;
+    return unavailable;
+  }
+
+  int fds_[EVENT_COUNT];
+};
+
+// Counts the hardware events between construction and stop() (or
+// destruction) and reports them on the benchmark state as per-iteration
+// counters, plus IPC. Declare it right before the measured loop, and wrap
+// untimed setup inside it in pause() and resume() as well as
+// PauseTiming(). Events that could not be opened are left out of the
+// report.
+template <typename State>
+class PerfScope {
+ public:
+  explicit PerfScope(State& state) : state_(state) { counters_.start(); }
+
+  ~PerfScope() { stop(); }
+
+  void pause() { counters_.stop(); }
+  void resume() { counters_.resume(); }
+
+  // End the measurement before any work that follows the loop
+  void stop() {
+    if (stopped_) return;
+    stopped_ = true;
+    counters_.stop();
+    if (state_.iterations() == 0) return;
+
+    using Counter = typename std::remove_reference_t<
+        decltype(state_.counters)>::mapped_type;
+    double values[PerfCounters::EVENT_COUNT];
+    bool valid[PerfCounters::EVENT_COUNT];
+    for (int i = 0; i < PerfCounters::EVENT_COUNT; ++i) {
+      const auto event = static_cast<PerfCounters::Event>(i);
+      valid[i] = counters_.read(event, values[i]);
+      if (valid[i]) {
+        state_.counters[PerfCounters::NAMES[i]] =
+            Counter(values[i], Counter::kAvgIterations);
+      }
+    }
+    if (valid[PerfCounters::Cycles] && valid[PerfCounters::Instructions] &&
+        values[PerfCounters::Cycles] > 0) {
+      state_.counters["IPC"] =
+          values[PerfCounters::Instructions] / values[PerfCounters::Cycles];
+    }
+  }
+
+ private:
+  State& state_;
+  PerfCounters counters_;
+  bool stopped_ = false;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+// USDT (user statically defined tracing) probes for attaching to a running
+// process with bpftrace or perf, no rebuild needed. An unattached probe is
+// a single nop plus an ELF note; the arguments must already be in
+// registers, so pass values the code has computed anyway.
+//
+// Provider json_serializer:
+//   message_start    (kind, request_id)
+//   message_end      (kind, request_id, bytes)
+//   message_rejected (request_id, verdict)   v3 pre-trade check failed
+//   buffer_grow      (old_capacity, new_capacity)   v3 Buffer::reserve
+//   buffer_overflow  (requested, capacity)   v4 StaticBuffer
+//   number_fallback  (key)   v3 number that to_chars could not format
+// kind is a runtime_stats::Kind. v4 does not assign request ids; it passes 0.
+//
+// e.g. bpftrace -p $PID -e '
+//   usdt:./json_serializer_v3:json_serializer:message_start { @t[tid] = nsecs; }
+//   usdt:./json_serializer_v3:json_serializer:message_end /@t[tid]/ {
+//     @ns = hist(nsecs - @t[tid]); delete(@t[tid]); }'
+//
+// Probes are compiled in when <sys/sdt.h> (systemtap-sdt-dev) is available;
+// define DISABLE_USDT, or configure with -DENABLE_USDT=OFF, to leave them out.
+
+#if !defined(DISABLE_USDT) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SERIALIZER_USDT 1
+#define SERIALIZER_PROBE1(name, a) DTRACE_PROBE1(json_serializer, name, a)
+#define SERIALIZER_PROBE2(name, a, b) \
+  DTRACE_PROBE2(json_serializer, name, a, b)
+#define SERIALIZER_PROBE3(name, a, b, c) \
+  DTRACE_PROBE3(json_serializer, name, a, b, c)
+#else
+#define SERIALIZER_USDT 0
+// Arguments are still evaluated, as with probes compiled in, so a value
+// computed only for a probe is not reported unused
+#define SERIALIZER_PROBE1(name, a) ((void)(a))
+#define SERIALIZER_PROBE2(name, a, b) ((void)(a), (void)(b))
+#define SERIALIZER_PROBE3(name, a, b, c) ((void)(a), (void)(b), (void)(c))
+#endif
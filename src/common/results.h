@@ -0,0 +1,158 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <sys/utsname.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "probes.h"
+
+// Keeps every benchmark run. results::init() makes the binary write Google
+// Benchmark JSON to <dir>/<name>-<YYYYmmdd-HHMMSS>.json alongside its
+// console output, and adds the environment to the file's context block:
+// CPU model, frequency governor, kernel, compiler and build flags.
+// tools/compare_results.py compares two such files.
+//
+// <dir> is --results_dir=DIR, else $BENCH_RESULTS_DIR, else ./results;
+// --results_dir= (empty) turns it off. An explicit --benchmark_out wins.
+//
+//   int main(int argc, char** argv) {
+//     results::init("v4", argc, argv);
+//     ::benchmark::Initialize(&argc, argv);
+//     ...
+namespace results {
+
+// First line of a file, or "unknown"
+inline std::string read_line(const char* path) {
+  std::ifstream in(path);
+  std::string line;
+  if (!in || !std::getline(in, line) || line.empty()) return "unknown";
+  return line;
+}
+
+inline std::string cpu_model() {
+  std::ifstream in("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.starts_with("model name")) {
+      const size_t colon = line.find(':');
+      if (colon != std::string::npos && colon + 2 <= line.size()) {
+        return line.substr(colon + 2);
+      }
+    }
+  }
+  return "unknown";
+}
+
+inline std::string compiler() {
+#if defined(__clang__)
+  return "clang " __clang_version__;
+#elif defined(__GNUC__)
+  return "gcc " __VERSION__;
+#else
+  return "unknown";
+#endif
+}
+
+// CMake passes its flags in as BENCH_CXX_FLAGS; by hand builds get the
+// features the compiler was told it may use
+inline std::string build_flags() {
+  std::string flags;
+#ifdef BENCH_CXX_FLAGS
+  flags = BENCH_CXX_FLAGS;
+#else
+#ifdef __OPTIMIZE__
+  flags = "optimized";
+#else
+  flags = "unoptimized";
+#endif
+#ifdef __AVX2__
+  flags += " avx2";
+#endif
+#ifdef __AVX512F__
+  flags += " avx512f";
+#endif
+#ifdef __BMI2__
+  flags += " bmi2";
+#endif
+#endif
+#ifdef ENABLE_TRACING
+  flags += " ENABLE_TRACING";
+#endif
+  if (SERIALIZER_USDT) flags += " usdt";
+  return flags;
+}
+
+inline std::string kernel() {
+  utsname name;
+  if (::uname(&name) != 0) return "unknown";
+  return std::string(name.sysname) + " " + name.release;
+}
+
+inline std::string timestamp() {
+  const std::time_t now = std::time(nullptr);
+  std::tm local;
+  localtime_r(&now, &local);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), "%Y%m%d-%H%M%S", &local);
+  return buf;
+}
+
+// Rewrites argc/argv for benchmark::Initialize and records the
+// environment; returns the results file, empty when not writing one
+inline std::string init(const char* name, int& argc, char**& argv) {
+  static std::vector<std::string> extra;
+  static std::vector<char*> args;
+
+  std::string dir = "results";
+  if (const char* env = std::getenv("BENCH_RESULTS_DIR")) dir = env;
+  bool explicit_out = false;
+  args.assign(argv, argv + argc);
+  for (auto it = args.begin() + 1; it != args.end();) {
+    const std::string_view arg = *it;
+    if (arg.starts_with("--results_dir=")) {
+      dir = arg.substr(std::string_view("--results_dir=").size());
+      it = args.erase(it);
+      continue;
+    }
+    explicit_out |= arg.starts_with("--benchmark_out=");
+    ++it;
+  }
+
+  benchmark::AddCustomContext("binary", name);
+  benchmark::AddCustomContext("cpu_model", cpu_model());
+  benchmark::AddCustomContext(
+      "governor",
+      read_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor"));
+  benchmark::AddCustomContext("kernel", kernel());
+  benchmark::AddCustomContext("compiler", compiler());
+  benchmark::AddCustomContext("flags", build_flags());
+
+  std::string path;
+  if (!dir.empty() && !explicit_out) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+      std::fprintf(stderr, "cannot create %s: %s, results not kept\n",
+                   dir.c_str(), ec.message().c_str());
+    } else {
+      path = dir + "/" + name + "-" + timestamp() + ".json";
+      extra = {"--benchmark_out=" + path, "--benchmark_out_format=json"};
+      for (std::string& arg : extra) args.push_back(arg.data());
+    }
+  }
+  args.push_back(nullptr);
+  argc = static_cast<int>(args.size() - 1);
+  argv = args.data();
+  if (!path.empty()) std::fprintf(stderr, "results: %s\n", path.c_str());
+  return path;
+}
+
+}  // namespace results
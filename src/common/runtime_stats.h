@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Production counters for the serializers: messages and bytes per message
+// kind, output buffer high-water marks against capacity, and slow-path
+// hits. Each thread owns one cache-line aligned Block and updates it with
+// plain loads and stores (no read-modify-write), so counting costs a few
+// cycles and never bounces a line between cores. snapshot() may be called
+// from any thread; it reads every block with relaxed atomic loads.
+namespace runtime_stats {
+
+enum class Kind : uint8_t { Place, Edit, Cancel, Session, Other, Count };
+
+inline constexpr const char* KIND_NAMES[] = {"place", "edit", "cancel",
+                                             "session", "other"};
+inline constexpr size_t KIND_COUNT = static_cast<size_t>(Kind::Count);
+
+struct Counters {
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  uint64_t high_water = 0;  // largest message
+  uint64_t capacity = 0;    // of the buffer it was written into
+};
+
+struct alignas(64) Block {
+  std::array<Counters, KIND_COUNT> kinds{};
+  uint64_t buffer_growths = 0;    // v3 Buffer reallocations
+  uint64_t buffer_overflows = 0;  // v4 StaticBuffer writes past capacity
+  std::string name;
+};
+
+// Single writer: a plain store the compiler may not split or elide
+inline void store(uint64_t& counter, uint64_t value) {
+  std::atomic_ref<uint64_t>(counter).store(value, std::memory_order_relaxed);
+}
+
+inline uint64_t load(const uint64_t& counter) {
+  return std::atomic_ref<const uint64_t>(counter).load(
+      std::memory_order_relaxed);
+}
+
+[[gnu::always_inline]] inline void record(Block& block, Kind kind,
+                                          size_t bytes, size_t capacity) {
+  Counters& c = block.kinds[static_cast<size_t>(kind)];
+  store(c.messages, c.messages + 1);
+  store(c.bytes, c.bytes + bytes);
+  if (bytes > c.high_water) store(c.high_water, bytes);
+  if (capacity != c.capacity) store(c.capacity, capacity);
+}
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Block>> blocks;  // kept until exit
+};
+
+inline Registry& registry() {
+  static Registry registry;
+  return registry;
+}
+
+inline thread_local Block* tls_block = nullptr;
+
+// The calling thread's block, created on first call; do it before the hot
+// path starts
+inline Block& register_thread(std::string name) {
+  if (tls_block) return *tls_block;
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.blocks.push_back(std::make_unique<Block>());
+  reg.blocks.back()->name = std::move(name);
+  tls_block = reg.blocks.back().get();
+  return *tls_block;
+}
+
+// Rare events raised by the buffers themselves, counted on the calling
+// thread's block if it has one
+inline void buffer_grew() {
+  if (Block* block = tls_block) {
+    store(block->buffer_growths, block->buffer_growths + 1);
+  }
+}
+
+inline void buffer_overflowed() {
+  if (Block* block = tls_block) {
+    store(block->buffer_overflows, block->buffer_overflows + 1);
+  }
+}
+
+struct ThreadSnapshot {
+  std::string name;
+  std::array<Counters, KIND_COUNT> kinds{};
+  uint64_t buffer_growths = 0;
+  uint64_t buffer_overflows = 0;
+};
+
+struct Snapshot {
+  std::vector<ThreadSnapshot> threads;
+  ThreadSnapshot total;  // sums, and the maxima of high_water and capacity
+
+  void print(std::FILE* out = stdout) const {
+    std::fprintf(out, "%-16s %-8s %12s %14s %10s %10s\n", "thread", "kind",
+                 "messages", "bytes", "high_water", "capacity");
+    auto rows = [&](const ThreadSnapshot& t) {
+      for (size_t k = 0; k < KIND_COUNT; ++k) {
+        const Counters& c = t.kinds[k];
+        if (c.messages == 0) continue;
+        std::fprintf(out, "%-16s %-8s %12lu %14lu %10lu %10lu\n",
+                     t.name.c_str(), KIND_NAMES[k], c.messages, c.bytes,
+                     c.high_water, c.capacity);
+      }
+      std::fprintf(out, "%-16s buffer growths %lu, overflows %lu\n",
+                   t.name.c_str(), t.buffer_growths, t.buffer_overflows);
+    };
+    for (const ThreadSnapshot& t : threads) rows(t);
+    if (threads.size() > 1) rows(total);
+  }
+};
+
+inline Snapshot snapshot() {
+  Snapshot out;
+  out.total.name = "total";
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for (const auto& block : reg.blocks) {
+    ThreadSnapshot t;
+    t.name = block->name;
+    for (size_t k = 0; k < KIND_COUNT; ++k) {
+      const Counters& c = block->kinds[k];
+      Counters& mine = t.kinds[k];
+      Counters& sum = out.total.kinds[k];
+      mine = Counters{load(c.messages), load(c.bytes), load(c.high_water),
+                      load(c.capacity)};
+      sum.messages += mine.messages;
+      sum.bytes += mine.bytes;
+      sum.high_water = std::max(sum.high_water, mine.high_water);
+      sum.capacity = std::max(sum.capacity, mine.capacity);
+    }
+    t.buffer_growths = load(block->buffer_growths);
+    t.buffer_overflows = load(block->buffer_overflows);
+    out.total.buffer_growths += t.buffer_growths;
+    out.total.buffer_overflows += t.buffer_overflows;
+    out.threads.push_back(std::move(t));
+  }
+  return out;
+}
+
+}  // namespace runtime_stats
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tsc_clock.h"
+
+// Per-stage trace points for the order path. Each thread that calls
+// trace::register_thread() gets its own ring of fixed-size events; a trace
+// point is a TSC read and a 16 byte store into that ring, oldest events
+// are overwritten. Threads that never registered skip every trace point
+// after one thread-local load. trace::dump() writes all rings to a binary
+// file for trace_to_chrome.
+//
+// The TRACE_* macros compile to nothing unless ENABLE_TRACING is defined.
+
+enum class TraceStage : uint16_t {
+  StrategyDecision,
+  Serialize,
+  Enqueue,
+  SendSyscall,
+  ResponseParsed,
+};
+
+inline constexpr const char* TRACE_STAGE_NAMES[] = {
+    "strategy_decision", "serialize", "enqueue", "send_syscall",
+    "response_parsed"};
+
+enum class TracePhase : uint8_t { Begin = 'B', End = 'E', Instant = 'i' };
+
+struct TraceEvent {
+  uint64_t tsc;
+  uint32_t arg;  // request id, byte count, ... depending on the stage
+  TraceStage stage;
+  TracePhase phase;
+  uint8_t reserved;
+};
+static_assert(sizeof(TraceEvent) == 16);
+
+// Single-producer flight recorder. The owning thread writes; anyone may
+// snapshot, though events written during a snapshot may come out torn.
+template <size_t Capacity>
+class TraceRing {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+ public:
+  explicit TraceRing(std::string name)
+      : events_(std::make_unique<TraceEvent[]>(Capacity)),
+        name_(std::move(name)) {}
+
+  [[gnu::always_inline]] inline void record(TraceStage stage,
+                                            TracePhase phase, uint32_t arg) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    events_[head & (Capacity - 1)] =
+        TraceEvent{TscClock::now(), arg, stage, phase, 0};
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  // Oldest first
+  std::vector<TraceEvent> snapshot() const {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t count = std::min<uint64_t>(head, Capacity);
+    std::vector<TraceEvent> out;
+    out.reserve(count);
+    for (uint64_t i = head - count; i < head; ++i) {
+      out.push_back(events_[i & (Capacity - 1)]);
+    }
+    return out;
+  }
+
+  [[nodiscard]] const std::string& name() const { return name_; }
+  [[nodiscard]] uint64_t recorded() const {
+    return head_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  alignas(64) std::atomic<uint64_t> head_{0};
+  std::unique_ptr<TraceEvent[]> events_;
+  std::string name_;
+};
+
+namespace trace {
+
+inline constexpr size_t RING_CAPACITY = 1 << 16;
+using Ring = TraceRing<RING_CAPACITY>;
+
+// File: "TRCE" u32 version, u64 calibration mult (TSC ticks to ns, 32.32
+// fixed point), u32 thread count; per thread: u32 tid, u32 name length,
+// name, u64 event count, events
+inline constexpr char MAGIC[4] = {'T', 'R', 'C', 'E'};
+inline constexpr uint32_t VERSION = 1;
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Ring>> rings;  // kept until exit
+};
+
+inline Registry& registry() {
+  static Registry registry;
+  return registry;
+}
+
+inline thread_local Ring* tls_ring = nullptr;
+
+// Give the calling thread a ring; call once per thread, off the hot path
+inline Ring& register_thread(std::string name) {
+  if (tls_ring) return *tls_ring;
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.rings.push_back(std::make_unique<Ring>(std::move(name)));
+  tls_ring = reg.rings.back().get();
+  return *tls_ring;
+}
+
+[[gnu::always_inline]] inline void record(TraceStage stage, TracePhase phase,
+                                          uint32_t arg) {
+  if (Ring* ring = tls_ring) ring->record(stage, phase, arg);
+}
+
+class Scope {
+ public:
+  [[gnu::always_inline]] Scope(TraceStage stage, uint32_t arg)
+      : stage_(stage), arg_(arg) {
+    record(stage_, TracePhase::Begin, arg_);
+  }
+  [[gnu::always_inline]] ~Scope() { record(stage_, TracePhase::End, arg_); }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  TraceStage stage_;
+  uint32_t arg_;
+};
+
+inline bool dump(const char* path) {
+  std::FILE* file = std::fopen(path, "wb");
+  if (!file) return false;
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+
+  auto put = [&](const void* data, size_t size) {
+    return std::fwrite(data, 1, size, file) == size;
+  };
+  const uint64_t mult = TscClock::calibration().mult;
+  const uint32_t threads = static_cast<uint32_t>(reg.rings.size());
+  bool ok = put(MAGIC, sizeof(MAGIC)) && put(&VERSION, sizeof(VERSION)) &&
+            put(&mult, sizeof(mult)) && put(&threads, sizeof(threads));
+  for (uint32_t tid = 0; ok && tid < threads; ++tid) {
+    const Ring& ring = *reg.rings[tid];
+    const std::vector<TraceEvent> events = ring.snapshot();
+    const uint32_t name_len = static_cast<uint32_t>(ring.name().size());
+    const uint64_t count = events.size();
+    ok = put(&tid, sizeof(tid)) && put(&name_len, sizeof(name_len)) &&
+         put(ring.name().data(), name_len) && put(&count, sizeof(count)) &&
+         put(events.data(), count * sizeof(TraceEvent));
+  }
+  return std::fclose(file) == 0 && ok;
+}
+
+}  // namespace trace
+
+#ifdef ENABLE_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(stage, arg)                    \
+  ::trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)( \
+      ::TraceStage::stage, static_cast<uint32_t>(arg))
+#define TRACE_INSTANT(stage, arg)                             \
+  ::trace::record(::TraceStage::stage, ::TracePhase::Instant, \
+                  static_cast<uint32_t>(arg))
+#else
+#define TRACE_SCOPE(stage, arg) ((void)0)
+#define TRACE_INSTANT(stage, arg) ((void)0)
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TSC_CLOCK_X86 1
+#endif
+
+// Conversion from TSC ticks to nanoseconds as a 32.32 fixed point
+// multiplier, so the hot path is one multiply and one shift
+struct TscCalibration {
+  uint64_t mult = uint64_t{1} << 32;
+
+  [[nodiscard]] inline uint64_t to_ns(uint64_t ticks) const {
+    return static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(ticks) * mult) >> 32);
+  }
+
+  [[nodiscard]] double ns_per_tick() const {
+    return static_cast<double>(mult) / static_cast<double>(uint64_t{1} << 32);
+  }
+};
+
+// Timestamps from the invariant TSC. start() fences so earlier work cannot
+// drift into the timed region, stop() uses rdtscp so the timed work has
+// retired before the counter is read. Without a TSC both fall back to
+// steady_clock nanoseconds and the calibration is the identity.
+class TscClock {
+ public:
+  [[nodiscard, gnu::always_inline]] static inline uint64_t start() {
+#ifdef TSC_CLOCK_X86
+    _mm_lfence();
+    const uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    return steady_ns();
+#endif
+  }
+
+  [[nodiscard, gnu::always_inline]] static inline uint64_t stop() {
+#ifdef TSC_CLOCK_X86
+    unsigned int aux;
+    const uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+#else
+    return steady_ns();
+#endif
+  }
+
+  // Unfenced read for timestamps that do not bracket a region
+  [[nodiscard, gnu::always_inline]] static inline uint64_t now() {
+#ifdef TSC_CLOCK_X86
+    return __rdtsc();
+#else
+    return steady_ns();
+#endif
+  }
+
+  // Measured once per process against steady_clock
+  static const TscCalibration& calibration() {
+    static const TscCalibration calibration = calibrate();
+    return calibration;
+  }
+
+  [[nodiscard]] static inline uint64_t now_ns() {
+    return calibration().to_ns(now());
+  }
+
+  // Spin until now_ns() reaches deadline_ns. Sleeping would hand the core
+  // back to the scheduler and add wake-up jitter to every gap.
+  static inline void wait_until(uint64_t deadline_ns) {
+    while (now_ns() < deadline_ns) {
+#ifdef TSC_CLOCK_X86
+      _mm_pause();
+#endif
+    }
+  }
+
+ private:
+  static uint64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static TscCalibration calibrate() {
+    TscCalibration result;
+#ifdef TSC_CLOCK_X86
+    // Median of a few short windows, so one window preempted between its
+    // paired reads does not skew the result
+    double ticks_per_ns[5];
+    for (double& sample : ticks_per_ns) {
+      const uint64_t ns0 = steady_ns();
+      const uint64_t t0 = start();
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      const uint64_t t1 = stop();
+      const uint64_t ns1 = steady_ns();
+      sample = static_cast<double>(t1 - t0) / static_cast<double>(ns1 - ns0);
+    }
+    std::sort(std::begin(ticks_per_ns), std::end(ticks_per_ns));
+    const double median = ticks_per_ns[2];
+    if (median > 0.0) {
+      result.mult = static_cast<uint64_t>(
+          static_cast<double>(uint64_t{1} << 32) / median);
+    }
+#endif
+    return result;
+  }
+};
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "canonical.h"
+
+// Seeded stream of realistic order traffic, generated up front so the
+// timed loop only indexes into arrays. Prices random-walk per instrument on
+// that instrument's tick size, instrument names and labels vary in length,
+// and places, edits and cancels are interleaved at a configurable ratio.
+// Edits and cancels refer to orders placed earlier in the stream.
+
+struct WorkloadConfig {
+  uint64_t seed = 42;
+  size_t instruments = 64;
+  // Relative weights of the message kinds
+  unsigned place_weight = 5;
+  unsigned edit_weight = 4;
+  unsigned cancel_weight = 1;
+  // Largest number of decimals a tick size may have
+  int max_decimals = 4;
+  size_t max_label_size = 32;
+};
+
+enum class WorkloadKind : uint8_t { Place, Edit, Cancel };
+
+struct WorkloadEvent {
+  WorkloadKind kind;
+  uint32_t index;  // into places, edits or cancels
+};
+
+struct WorkloadStream {
+  std::vector<canonical::Place> places;
+  std::vector<canonical::Edit> edits;
+  std::vector<canonical::Cancel> cancels;
+  std::vector<WorkloadEvent> events;
+};
+
+class WorkloadGenerator {
+ public:
+  explicit WorkloadGenerator(WorkloadConfig config = {})
+      : config_(config), rng_(config.seed) {
+    make_instruments();
+  }
+
+  // count events in the configured mix. The stream starts with places so
+  // edits and cancels always have a live order to refer to.
+  WorkloadStream generate(size_t count) {
+    WorkloadStream out;
+    out.events.reserve(count);
+    std::vector<std::string> order_ids;  // parallel to out.places
+    std::vector<size_t> live;            // indices into out.places
+    std::discrete_distribution<int> kind_dist(
+        {static_cast<double>(config_.place_weight),
+         static_cast<double>(config_.edit_weight),
+         static_cast<double>(config_.cancel_weight)});
+
+    for (size_t i = 0; i < count; ++i) {
+      auto kind = static_cast<WorkloadKind>(kind_dist(rng_));
+      if (live.empty()) kind = WorkloadKind::Place;
+
+      switch (kind) {
+        case WorkloadKind::Place: {
+          live.push_back(out.places.size());
+          out.events.push_back(
+              {kind, static_cast<uint32_t>(out.places.size())});
+          out.places.push_back(make_place(order_ids.emplace_back()));
+          break;
+        }
+        case WorkloadKind::Edit: {
+          const size_t order = live[pick(live.size())];
+          out.events.push_back({kind, static_cast<uint32_t>(out.edits.size())});
+          out.edits.push_back(make_edit(out.places[order], order_ids[order]));
+          break;
+        }
+        case WorkloadKind::Cancel: {
+          const size_t at = pick(live.size());
+          out.events.push_back(
+              {kind, static_cast<uint32_t>(out.cancels.size())});
+          out.cancels.push_back(canonical::Cancel{order_ids[live[at]]});
+          live[at] = live.back();
+          live.pop_back();
+          break;
+        }
+      }
+    }
+    return out;
+  }
+
+  // Only places, e.g. for benchmarks of a single request type
+  std::vector<canonical::Place> places(size_t count) {
+    std::vector<canonical::Place> out;
+    out.reserve(count);
+    std::string order_id;
+    for (size_t i = 0; i < count; ++i) out.push_back(make_place(order_id));
+    return out;
+  }
+
+  // Edits spread over count / 4 resting orders
+  std::vector<canonical::Edit> edits(size_t count) {
+    const size_t orders = std::max<size_t>(count / 4, 1);
+    std::vector<canonical::Place> placed;
+    std::vector<std::string> order_ids(orders);
+    for (auto& order_id : order_ids) placed.push_back(make_place(order_id));
+
+    std::vector<canonical::Edit> out;
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      const size_t at = pick(orders);
+      out.push_back(make_edit(placed[at], order_ids[at]));
+    }
+    return out;
+  }
+
+ private:
+  // Prices and sizes are kept as integer counts of their increment, so the
+  // doubles handed out are the nearest ones to short decimals (0.3, not
+  // 0.30000000000000004)
+  struct Instrument {
+    std::string name;
+    int64_t ticks;       // price in ticks
+    int64_t tick_units;  // tick size in 1 / scale
+    double scale;        // 10^decimals
+    double volatility;   // per step, in ticks
+    int64_t lot_units;   // lot size in 1 / 10
+  };
+
+  static double price_of(const Instrument& inst, int64_t ticks) {
+    return static_cast<double>(ticks * inst.tick_units) / inst.scale;
+  }
+
+  int64_t walk(const Instrument& inst, int64_t ticks) {
+    std::normal_distribution<double> step(0.0, inst.volatility);
+    return std::max<int64_t>(1, ticks + std::llround(step(rng_)));
+  }
+
+  double size(const Instrument& inst) {
+    return static_cast<double>(inst.lot_units *
+                               static_cast<int64_t>(1 + pick(50))) /
+           10.0;
+  }
+
+  size_t pick(size_t n) {
+    return std::uniform_int_distribution<size_t>(0, n - 1)(rng_);
+  }
+
+  void make_instruments() {
+    static const char* currencies[] = {"BTC", "ETH", "SOL", "XRP"};
+    static const double spot[] = {65000.0, 3200.0, 150.0, 0.6};
+    static const char* expiries[] = {"27DEC24", "31JAN25", "28MAR25",
+                                     "27JUN25", "26SEP25"};
+
+    for (size_t i = 0; i < config_.instruments; ++i) {
+      const size_t c = pick(4);
+      Instrument inst;
+      double price;
+      inst.name = currencies[c];
+      switch (pick(3)) {
+        case 0:
+          inst.name += "-PERPETUAL";
+          price = spot[c];
+          break;
+        case 1:
+          inst.name += std::string("-") + expiries[pick(5)];
+          price = spot[c] * 1.01;
+          break;
+        default: {
+          // Option premium as a fraction of spot
+          const long strike =
+              std::lround(spot[c] * (0.5 + static_cast<double>(pick(100)) / 100.0));
+          inst.name += std::string("-") + expiries[pick(5)] + "-" +
+                       std::to_string(strike) + (pick(2) ? "-C" : "-P");
+          price = spot[c] * 0.02;
+          break;
+        }
+      }
+      const int decimals = static_cast<int>(pick(config_.max_decimals + 1));
+      inst.scale = std::pow(10.0, decimals);
+      inst.tick_units = pick(2) ? 5 : 1;
+      inst.ticks = std::max<int64_t>(
+          1, std::llround(price * inst.scale / inst.tick_units));
+      inst.volatility = 1.0 + static_cast<double>(pick(20));
+      inst.lot_units = std::llround(std::pow(10.0, pick(4)));
+      instruments_.push_back(std::move(inst));
+    }
+  }
+
+  canonical::Place make_place(std::string& order_id) {
+    const size_t at = pick(instruments_.size());
+    Instrument& inst = instruments_[at];
+    inst.ticks = walk(inst, inst.ticks);
+    order_id = inst.name.substr(0, 3) + "-" + std::to_string(next_order_++);
+
+    static const char* tifs[] = {"good_til_cancelled", "immediate_or_cancel",
+                                 "fill_or_kill"};
+    return canonical::Place{
+        .instrument_name = inst.name,
+        .amount = size(inst),
+        .price = price_of(inst, inst.ticks),
+        .type = pick(10) == 0 ? "market" : "limit",
+        .label = label(),
+        .reduce_only = pick(8) == 0,
+        .post_only = pick(2) == 0,
+        .time_in_force = tifs[pick(10) < 8 ? 0 : 1 + pick(2)],
+        .max_show = size(inst)};
+  }
+
+  canonical::Edit make_edit(const canonical::Place& order,
+                            const std::string& order_id) {
+    const Instrument* inst = &instruments_.front();
+    for (const auto& candidate : instruments_) {
+      if (candidate.name == order.instrument_name) inst = &candidate;
+    }
+    const int64_t ticks = std::llround(order.price * inst->scale /
+                                       static_cast<double>(inst->tick_units));
+    return canonical::Edit{.order_id = order_id,
+                           .amount = order.amount,
+                           .price = price_of(*inst, walk(*inst, ticks)),
+                           .post_only = order.post_only,
+                           .max_show = order.max_show};
+  }
+
+  std::string label() {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789_-";
+    std::string out(pick(config_.max_label_size + 1), ' ');
+    for (char& c : out) c = alphabet[pick(sizeof(alphabet) - 1)];
+    return out;
+  }
+
+  WorkloadConfig config_;
+  std::mt19937_64 rng_;
+  std::vector<Instrument> instruments_;
+  uint64_t next_order_ = 349223;
+};
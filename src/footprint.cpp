@@ -0,0 +1,345 @@
+#include <benchmark/benchmark.h>
+#include <cxxabi.h>
+#include <elf.h>
+#include <link.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/results.h"
+#include "common/workload.h"
+#include "unified_adapters.h"
+
+// Machine-code footprint of the serializers, and what it costs when the
+// instruction cache cannot hold it.
+//
+// Each version and schema gets an out-of-line entry that serializes one
+// message with every call inside it inlined (flatten), so the entry's
+// symbol size is the whole specialized serializer. Next to it the report
+// lists what the compiler keeps out of line when left to its own inlining
+// choices, per version. Sizes come from the binary's own symbol table, so
+// do not strip it.
+//
+// BM_ICachePressure/<version>/copies:N calls N distinct copies of those
+// entries round robin, cycling place, edit and cancel. The data is the
+// same for every copy; only the code grows, so ns/msg against code_bytes
+// shows where the footprint stops fitting in L1i and L2.
+
+#if defined(__clang__)
+#define FOOTPRINT_ENTRY [[gnu::noinline, gnu::flatten]]
+#else
+// Identical copies must not be folded into one
+#define FOOTPRINT_ENTRY [[gnu::noinline, gnu::flatten, gnu::no_icf]]
+#endif
+
+static constexpr size_t MAX_COPIES = 64;
+static constexpr size_t SCHEMAS = 3;
+static constexpr const char* SCHEMA_NAMES[SCHEMAS] = {"place", "edit",
+                                                      "cancel"};
+
+// Function symbols of the running executable, by address
+class SymbolTable {
+ public:
+  struct Symbol {
+    uint64_t size;
+    std::string name;  // demangled
+  };
+
+  static const SymbolTable& self() {
+    static const SymbolTable table;
+    return table;
+  }
+
+  [[nodiscard]] bool loaded() const { return !symbols_.empty(); }
+  [[nodiscard]] const std::map<uint64_t, Symbol>& symbols() const {
+    return symbols_;
+  }
+
+  // Size of the function at a runtime address, 0 if unknown
+  [[nodiscard]] uint64_t size_of(const void* fn) const {
+    const uint64_t addr = reinterpret_cast<uintptr_t>(fn) - load_base_;
+    auto it = symbols_.find(addr);
+    return it == symbols_.end() ? 0 : it->second.size;
+  }
+
+ private:
+  SymbolTable() {
+    dl_iterate_phdr(
+        [](dl_phdr_info* info, size_t, void* base) {
+          *static_cast<uint64_t*>(base) = info->dlpi_addr;
+          return 1;  // the executable comes first
+        },
+        &load_base_);
+
+    std::ifstream in("/proc/self/exe", std::ios::binary);
+    const std::vector<char> image((std::istreambuf_iterator<char>(in)),
+                                  std::istreambuf_iterator<char>());
+    if (image.size() < sizeof(Elf64_Ehdr)) return;
+    Elf64_Ehdr header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+        header.e_ident[EI_CLASS] != ELFCLASS64 ||
+        header.e_shoff + header.e_shnum * sizeof(Elf64_Shdr) > image.size()) {
+      return;
+    }
+
+    std::vector<Elf64_Shdr> sections(header.e_shnum);
+    std::memcpy(sections.data(), image.data() + header.e_shoff,
+                sections.size() * sizeof(Elf64_Shdr));
+    for (const Elf64_Shdr& section : sections) {
+      if (section.sh_type != SHT_SYMTAB || section.sh_link >= sections.size()) {
+        continue;
+      }
+      const Elf64_Shdr& strings = sections[section.sh_link];
+      if (section.sh_offset + section.sh_size > image.size() ||
+          strings.sh_offset + strings.sh_size > image.size()) {
+        continue;
+      }
+      const size_t count = section.sh_size / sizeof(Elf64_Sym);
+      for (size_t i = 0; i < count; ++i) {
+        Elf64_Sym sym;
+        std::memcpy(&sym, image.data() + section.sh_offset + i * sizeof(sym),
+                    sizeof(sym));
+        if (ELF64_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_size == 0 ||
+            sym.st_name >= strings.sh_size) {
+          continue;
+        }
+        const char* mangled = image.data() + strings.sh_offset + sym.st_name;
+        symbols_[sym.st_value] = Symbol{sym.st_size, demangle(mangled)};
+      }
+    }
+  }
+
+  static std::string demangle(const char* mangled) {
+    int status = 0;
+    std::unique_ptr<char, decltype(&std::free)> name(
+        abi::__cxa_demangle(mangled, nullptr, nullptr, &status), &std::free);
+    return status == 0 ? std::string(name.get()) : std::string(mangled);
+  }
+
+  uint64_t load_base_ = 0;
+  std::map<uint64_t, Symbol> symbols_;
+};
+
+static const WorkloadStream& stream() {
+  static const WorkloadStream stream = WorkloadGenerator().generate(64);
+  return stream;
+}
+
+template <typename Adapter>
+struct Requests {
+  typename Adapter::PlaceRequest place;
+  typename Adapter::EditRequest edit;
+  typename Adapter::CancelRequest cancel;
+
+  static Requests make() {
+    const WorkloadStream& s = stream();
+    return {Adapter::make_place(s.places.front()),
+            Adapter::make_edit(s.edits.front()),
+            Adapter::make_cancel(s.cancels.front())};
+  }
+};
+
+// Copy N serializes schema N % 3; copies 0..2 are the measured entries
+template <typename Adapter, size_t Copy>
+FOOTPRINT_ENTRY std::string_view serialize_copy(Adapter& adapter,
+                                                const Requests<Adapter>& r) {
+  if constexpr (Copy % SCHEMAS == 0) {
+    return adapter.place(r.place);
+  } else if constexpr (Copy % SCHEMAS == 1) {
+    return adapter.edit(r.edit);
+  } else {
+    return adapter.cancel(r.cancel);
+  }
+}
+
+template <typename Adapter>
+using Entry = std::string_view (*)(Adapter&, const Requests<Adapter>&);
+
+// The same calls without flatten, so the binary holds each version's
+// serializer as the compiler would inline it anywhere else
+template <typename Adapter, size_t Schema>
+[[gnu::noinline]] std::string_view serialize_as_compiled(
+    Adapter& adapter, const Requests<Adapter>& r) {
+  if constexpr (Schema == 0) {
+    return adapter.place(r.place);
+  } else if constexpr (Schema == 1) {
+    return adapter.edit(r.edit);
+  } else {
+    return adapter.cancel(r.cancel);
+  }
+}
+
+template <typename Adapter>
+static constexpr Entry<Adapter> AS_COMPILED[SCHEMAS] = {
+    &serialize_as_compiled<Adapter, 0>, &serialize_as_compiled<Adapter, 1>,
+    &serialize_as_compiled<Adapter, 2>};
+
+template <typename Adapter, size_t... Copies>
+static constexpr std::array<Entry<Adapter>, sizeof...(Copies)> make_copies(
+    std::index_sequence<Copies...>) {
+  return {&serialize_copy<Adapter, Copies>...};
+}
+
+template <typename Adapter>
+static const std::array<Entry<Adapter>, MAX_COPIES>& copies() {
+  static constexpr auto table =
+      make_copies<Adapter>(std::make_index_sequence<MAX_COPIES>());
+  return table;
+}
+
+template <typename Adapter>
+static uint64_t code_bytes(size_t count) {
+  uint64_t bytes = 0;
+  for (size_t i = 0; i < count; ++i) {
+    bytes += SymbolTable::self().size_of(
+        reinterpret_cast<const void*>(copies<Adapter>()[i]));
+  }
+  return bytes;
+}
+
+template <typename Adapter>
+static void run_round_robin(benchmark::State& state,
+                            const Entry<Adapter>* entries, size_t count) {
+  const Requests<Adapter> requests = Requests<Adapter>::make();
+  Adapter adapter;
+  size_t i = 0;
+
+  for (auto _ : state) {
+    auto frame = entries[i](adapter, requests);
+    benchmark::DoNotOptimize(frame.data());
+    if (++i == count) i = 0;
+  }
+}
+
+template <typename Adapter>
+static void BM_ICachePressure(benchmark::State& state) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  run_round_robin<Adapter>(state, copies<Adapter>().data(), count);
+  state.counters["code_bytes"] = static_cast<double>(code_bytes<Adapter>(count));
+}
+
+// The three schemas through the compiler's own inlining, to set against
+// copies:3 of BM_ICachePressure
+template <typename Adapter>
+static void BM_AsCompiled(benchmark::State& state) {
+  run_round_robin<Adapter>(state, AS_COMPILED<Adapter>, SCHEMAS);
+}
+
+template <typename Adapter>
+static void register_version() {
+  const std::string name = std::string("BM_ICachePressure/") + Adapter::NAME;
+  auto* bench = benchmark::RegisterBenchmark(name.c_str(),
+                                             BM_ICachePressure<Adapter>);
+  for (size_t n = SCHEMAS; n <= MAX_COPIES; n *= 2) bench->Arg(n);
+  bench->Arg(MAX_COPIES)->ArgName("copies");
+
+  benchmark::RegisterBenchmark(
+      (std::string("BM_AsCompiled/") + Adapter::NAME).c_str(),
+      BM_AsCompiled<Adapter>);
+}
+
+template <typename Adapter>
+static void print_entries() {
+  std::printf("%-4s", Adapter::NAME);
+  for (size_t s = 0; s < SCHEMAS; ++s) {
+    std::printf(" %8lu", SymbolTable::self().size_of(reinterpret_cast<const void*>(
+                             copies<Adapter>()[s])));
+  }
+  std::printf("\n");
+}
+
+// Whether a demangled name belongs to a version: its namespace or adapter
+// at the start, after a return type, or as a template argument
+static bool belongs_to(std::string_view name, std::string_view ns,
+                       std::string_view adapter) {
+  if (name.find("serialize_copy<") != std::string_view::npos ||
+      name.find("serialize_as_compiled<") != std::string_view::npos) {
+    return false;
+  }
+  for (std::string_view prefix : {ns, adapter}) {
+    for (size_t at = name.find(prefix); at != std::string_view::npos;
+         at = name.find(prefix, at + 1)) {
+      if (at == 0 || name[at - 1] == ' ' || name[at - 1] == '<') return true;
+    }
+  }
+  return false;
+}
+
+// Out-of-line functions of each version, largest first
+static void print_out_of_line(size_t top) {
+  static constexpr std::pair<const char*, const char*> VERSIONS[] = {
+      {"v1::", "V1Adapter::"},
+      {"v2::", "V2Adapter::"},
+      {"v3::", "V3Adapter::"},
+      {"v4::", "V4Adapter::"}};
+  for (const auto& [ns, adapter] : VERSIONS) {
+    std::vector<const SymbolTable::Symbol*> found;
+    uint64_t total = 0;
+    for (const auto& [addr, symbol] : SymbolTable::self().symbols()) {
+      if (belongs_to(symbol.name, ns, adapter)) {
+        found.push_back(&symbol);
+        total += symbol.size;
+      }
+    }
+    std::sort(found.begin(), found.end(),
+              [](const auto* a, const auto* b) { return a->size > b->size; });
+    std::printf("%.2s: %zu out-of-line functions, %lu bytes\n", ns,
+                found.size(), total);
+    for (size_t i = 0; i < std::min(top, found.size()); ++i) {
+      std::string name = found[i]->name;
+      // Keep both ends; the method is at the back of a long template name
+      if (name.size() > 100) {
+        name = name.substr(0, 45) + "..." + name.substr(name.size() - 52);
+      }
+      std::printf("  %8lu  %s\n", found[i]->size, name.c_str());
+    }
+  }
+}
+
+static void print_report() {
+  if (!SymbolTable::self().loaded()) {
+    std::printf("no symbol table in /proc/self/exe (stripped?), "
+                "code sizes unavailable\n\n");
+    return;
+  }
+  const long l1i = ::sysconf(_SC_LEVEL1_ICACHE_SIZE);
+  std::printf("bytes of fully inlined code per serializer (L1i %ld bytes)\n",
+              l1i);
+  std::printf("%-4s %8s %8s %8s\n", "ver", SCHEMA_NAMES[0], SCHEMA_NAMES[1],
+              SCHEMA_NAMES[2]);
+  print_entries<V1Adapter>();
+  print_entries<V2Adapter>();
+  print_entries<V3Adapter>();
+  print_entries<V4Adapter>();
+  std::printf("\nas compiled, out of line\n");
+  print_out_of_line(5);
+  std::printf("\n");
+}
+
+int main(int argc, char** argv) {
+  register_version<V1Adapter>();
+  register_version<V2Adapter>();
+  register_version<V3Adapter>();
+  register_version<V4Adapter>();
+
+  results::init("footprint", argc, argv);
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  print_report();
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
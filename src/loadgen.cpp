@@ -0,0 +1,322 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/cpu_affinity.h"
+#include "common/latency_recorder.h"
+#include "common/tsc_clock.h"
+#include "common/workload.h"
+#include "unified_adapters.h"
+
+// Open-loop load generator. Requests arrive on a fixed schedule at the
+// offered rate whether or not the previous one has finished, and each
+// request is serialized and written to a sink. Latency runs from the
+// request's intended arrival time to the end of its send, so time spent
+// queued behind a slow request is counted (no coordinated omission).
+//
+//   json_serializer_loadgen [--version v1|v2|v3|v4|all] [--threads N]
+//                           [--arrivals poisson|constant] [--sink socket|none]
+//                           [--rates R1,R2,...] [--duration S] [--csv]
+//
+// The offered rate is split evenly over the threads. Without --rates the
+// sweep starts at 10k msgs/s and doubles until the achieved rate falls
+// below 90% of the offered one, giving one latency-throughput curve per
+// version up to saturation. The socket sink is an AF_UNIX stream pair per
+// thread with a peer thread that reads and discards; none only serializes.
+
+enum class Arrivals { Constant, Poisson };
+enum class Sink { None, Socket };
+
+struct LoadOptions {
+  std::string version = "all";
+  unsigned threads = 1;
+  Arrivals arrivals = Arrivals::Poisson;
+  Sink sink = Sink::Socket;
+  std::vector<double> rates;  // empty: sweep to saturation
+  double duration_s = 1.0;
+  bool csv = false;
+};
+
+struct StepResult {
+  double offered = 0.0;
+  double achieved = 0.0;
+  LatencyRecorder latency;
+};
+
+// Achieved below this fraction of offered counts as saturated
+static constexpr double SATURATED = 0.9;
+static constexpr double SWEEP_START = 10000.0;
+static constexpr double SWEEP_MAX = 1e8;
+// A saturated step stops once it has run this many times its duration;
+// arrivals it never reached are left out of the latencies
+static constexpr double MAX_OVERRUN = 2.0;
+
+// Local peer for one sender: writes go to fd(), a thread drains the other
+// end until the sender side is shut down
+class LoopbackSink {
+ public:
+  LoopbackSink() {
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_) != 0) {
+      std::perror("socketpair");
+      std::exit(1);
+    }
+    drain_ = std::thread([fd = fds_[1]]() {
+      char buf[64 * 1024];
+      while (::read(fd, buf, sizeof(buf)) > 0) {
+      }
+    });
+  }
+
+  ~LoopbackSink() {
+    ::shutdown(fds_[0], SHUT_WR);
+    drain_.join();
+    ::close(fds_[0]);
+    ::close(fds_[1]);
+  }
+
+  LoopbackSink(const LoopbackSink&) = delete;
+  LoopbackSink& operator=(const LoopbackSink&) = delete;
+
+  [[nodiscard]] int fd() const { return fds_[0]; }
+
+ private:
+  int fds_[2] = {-1, -1};
+  std::thread drain_;
+};
+
+template <typename Adapter>
+class LoadRun {
+ public:
+  explicit LoadRun(const WorkloadStream& stream)
+      : stream_(stream),
+        places_(convert(stream.places, Adapter::make_place)),
+        edits_(convert(stream.edits, Adapter::make_edit)),
+        cancels_(convert(stream.cancels, Adapter::make_cancel)) {}
+
+  StepResult step(double offered, const LoadOptions& options) {
+    struct alignas(128) Worker {
+      LatencyRecorder latency;
+      uint64_t sent = 0;
+      uint64_t finished_ns = 0;
+    };
+    std::vector<Worker> workers(options.threads);
+    std::barrier sync(static_cast<ptrdiff_t>(options.threads));
+    std::atomic<uint64_t> begin_ns{0};
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < options.threads; ++t) {
+      threads.emplace_back([&, t]() {
+        pin_to_cpu(t);
+        Worker& worker = workers[t];
+        Adapter adapter;
+        std::unique_ptr<LoopbackSink> sink;
+        if (options.sink == Sink::Socket) sink = std::make_unique<LoopbackSink>();
+        v3::FdTransport transport(sink ? sink->fd() : -1);
+
+        const double mean_gap_ns = 1e9 * options.threads / offered;
+        std::mt19937_64 rng(1000 + t);
+        std::exponential_distribution<double> poisson(1.0 / mean_gap_ns);
+        auto gap = [&]() {
+          return options.arrivals == Arrivals::Poisson ? poisson(rng)
+                                                       : mean_gap_ns;
+        };
+
+        // One clock origin for every thread, taken after all are ready
+        sync.arrive_and_wait();
+        uint64_t expected = 0;
+        begin_ns.compare_exchange_strong(expected, TscClock::now_ns());
+        const uint64_t begin = begin_ns.load();
+        const double end = static_cast<double>(begin) + options.duration_s * 1e9;
+        const uint64_t give_up =
+            begin + static_cast<uint64_t>(MAX_OVERRUN * options.duration_s * 1e9);
+
+        const size_t events = stream_.events.size();
+        size_t i = t * 977;
+        double intended = static_cast<double>(begin) + gap();
+        while (intended < end) {
+          const uint64_t intended_ns = static_cast<uint64_t>(intended);
+          TscClock::wait_until(intended_ns);
+
+          const WorkloadEvent& event = stream_.events[i++ % events];
+          std::string_view frame;
+          switch (event.kind) {
+            case WorkloadKind::Place:
+              frame = adapter.place(places_[event.index]);
+              break;
+            case WorkloadKind::Edit:
+              frame = adapter.edit(edits_[event.index]);
+              break;
+            case WorkloadKind::Cancel:
+              frame = adapter.cancel(cancels_[event.index]);
+              break;
+          }
+          if (sink) transport.send(frame);
+
+          const uint64_t done_ns = TscClock::now_ns();
+          worker.latency.record_ns(static_cast<int64_t>(done_ns - intended_ns));
+          ++worker.sent;
+          if (done_ns > give_up) break;
+          intended += gap();
+        }
+        worker.finished_ns = TscClock::now_ns();
+      });
+    }
+    for (auto& thread : threads) thread.join();
+
+    StepResult result;
+    result.offered = offered;
+    uint64_t sent = 0, finished = 0;
+    for (const Worker& worker : workers) {
+      result.latency.merge(worker.latency);
+      sent += worker.sent;
+      finished = std::max(finished, worker.finished_ns);
+    }
+    const double elapsed_s =
+        static_cast<double>(finished - begin_ns.load()) / 1e9;
+    result.achieved = elapsed_s > 0.0 ? static_cast<double>(sent) / elapsed_s
+                                      : 0.0;
+    return result;
+  }
+
+ private:
+  const WorkloadStream& stream_;
+  std::vector<typename Adapter::PlaceRequest> places_;
+  std::vector<typename Adapter::EditRequest> edits_;
+  std::vector<typename Adapter::CancelRequest> cancels_;
+};
+
+static void print_row(const char* version, const LoadOptions& options,
+                      const StepResult& r, bool saturated) {
+  const LatencyRecorder& l = r.latency;
+  if (options.csv) {
+    std::printf("%s,%u,%.0f,%.0f,%lu,%lu,%lu,%lu,%lu,%d\n", version,
+                options.threads, r.offered, r.achieved, l.percentile_ns(50.0),
+                l.percentile_ns(90.0), l.percentile_ns(99.0),
+                l.percentile_ns(99.9), l.histogram().max(), saturated);
+  } else {
+    std::printf("%-4s %7u %12.0f %12.0f %10lu %10lu %10lu %10lu %10lu%s\n",
+                version, options.threads, r.offered, r.achieved,
+                l.percentile_ns(50.0), l.percentile_ns(90.0),
+                l.percentile_ns(99.0), l.percentile_ns(99.9),
+                l.histogram().max(), saturated ? "  saturated" : "");
+  }
+  std::fflush(stdout);
+}
+
+template <typename Adapter>
+static void curve(const WorkloadStream& stream, const LoadOptions& options) {
+  LoadRun<Adapter> run(stream);
+  auto one = [&](double offered) {
+    const StepResult result = run.step(offered, options);
+    const bool saturated = result.achieved < SATURATED * offered;
+    print_row(Adapter::NAME, options, result, saturated);
+    return saturated;
+  };
+
+  if (!options.rates.empty()) {
+    for (double rate : options.rates) one(rate);
+    return;
+  }
+  for (double rate = SWEEP_START; rate <= SWEEP_MAX; rate *= 2) {
+    if (one(rate)) break;
+  }
+}
+
+static bool parse_rates(const char* list, std::vector<double>& rates) {
+  const char* p = list;
+  while (*p) {
+    char* end = nullptr;
+    const double rate = std::strtod(p, &end);
+    if (end == p || rate <= 0.0) return false;
+    rates.push_back(rate);
+    p = *end == ',' ? end + 1 : end;
+    if (*end && *end != ',') return false;
+  }
+  return !rates.empty();
+}
+
+static void usage() {
+  std::fprintf(stderr,
+               "usage: json_serializer_loadgen [--version v1|v2|v3|v4|all]"
+               " [--threads N]\n"
+               "                               [--arrivals poisson|constant]"
+               " [--sink socket|none]\n"
+               "                               [--rates R1,R2,...]"
+               " [--duration S] [--csv]\n");
+}
+
+int main(int argc, char** argv) {
+  LoadOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--version" && has_value) {
+      options.version = argv[++i];
+    } else if (arg == "--threads" && has_value) {
+      options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    } else if (arg == "--arrivals" && has_value) {
+      const std::string_view value = argv[++i];
+      if (value != "poisson" && value != "constant") {
+        usage();
+        return 1;
+      }
+      options.arrivals =
+          value == "poisson" ? Arrivals::Poisson : Arrivals::Constant;
+    } else if (arg == "--sink" && has_value) {
+      const std::string_view value = argv[++i];
+      if (value != "socket" && value != "none") {
+        usage();
+        return 1;
+      }
+      options.sink = value == "socket" ? Sink::Socket : Sink::None;
+    } else if (arg == "--rates" && has_value) {
+      if (!parse_rates(argv[++i], options.rates)) {
+        usage();
+        return 1;
+      }
+    } else if (arg == "--duration" && has_value) {
+      options.duration_s = std::strtod(argv[++i], nullptr);
+    } else if (arg == "--csv") {
+      options.csv = true;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (options.threads < 1 || options.duration_s <= 0.0) {
+    usage();
+    return 1;
+  }
+
+  const WorkloadStream stream = WorkloadGenerator().generate(4096);
+  if (options.csv) {
+    std::printf(
+        "version,threads,offered,achieved,p50_ns,p90_ns,p99_ns,p999_ns,"
+        "max_ns,saturated\n");
+  } else {
+    std::printf("%s arrivals, %s sink, %g s per step\n",
+                options.arrivals == Arrivals::Poisson ? "poisson" : "constant",
+                options.sink == Sink::Socket ? "socket" : "no", options.duration_s);
+    std::printf("%-4s %7s %12s %12s %10s %10s %10s %10s %10s\n", "ver",
+                "threads", "offered/s", "achieved/s", "p50_ns", "p90_ns",
+                "p99_ns", "p999_ns", "max_ns");
+  }
+
+  const std::string& v = options.version;
+  if (v == "all" || v == "v1") curve<V1Adapter>(stream, options);
+  if (v == "all" || v == "v2") curve<V2Adapter>(stream, options);
+  if (v == "all" || v == "v3") curve<V3Adapter>(stream, options);
+  if (v == "all" || v == "v4") curve<V4Adapter>(stream, options);
+  return 0;
+}
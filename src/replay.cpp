@@ -0,0 +1,241 @@
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/latency_recorder.h"
+#include "common/order_log.h"
+#include "common/tsc_clock.h"
+#include "common/workload.h"
+#include "unified_adapters.h"
+
+// Replays a captured order log through the serializer generations.
+//
+//   json_serializer_replay <log> [--version v1|v2|v3|v4|all] [--paced]
+//                                [--speed X] [--repeat N]
+//   json_serializer_replay --synthesize <count> <log>
+//
+// Flat out (the default) serializes every message back to back. --paced
+// waits until each message's capture offset, divided by --speed, has
+// elapsed, so the serializer sees production gaps and the cold caches that
+// come with them. Either way every message is timed on its own and the
+// latency percentiles and throughput are printed per version.
+// --synthesize writes a log from WorkloadGenerator with Poisson arrivals,
+// for trying the tool without a capture.
+
+struct ReplayOptions {
+  const char* path = nullptr;
+  std::string version = "all";
+  bool paced = false;
+  double speed = 1.0;
+  int repeat = 1;
+};
+
+template <typename Adapter>
+static void replay(const OrderLog& log, const ReplayOptions& options) {
+  const WorkloadStream& stream = log.stream;
+  const auto places = convert(stream.places, Adapter::make_place);
+  const auto edits = convert(stream.edits, Adapter::make_edit);
+  const auto cancels = convert(stream.cancels, Adapter::make_cancel);
+
+  Adapter adapter;
+  LatencyRecorder latency;
+  size_t bytes = 0;
+  const uint64_t first_ns = log.timestamps_ns.front();
+
+  const uint64_t begin_ns = TscClock::now_ns();
+  for (int round = 0; round < options.repeat; ++round) {
+    const uint64_t round_ns = TscClock::now_ns();
+    for (size_t i = 0; i < stream.events.size(); ++i) {
+      if (options.paced) {
+        TscClock::wait_until(
+            round_ns + static_cast<uint64_t>(
+                           (log.timestamps_ns[i] - first_ns) / options.speed));
+      }
+
+      const WorkloadEvent& event = stream.events[i];
+      const uint64_t t0 = latency.start();
+      std::string_view frame;
+      switch (event.kind) {
+        case WorkloadKind::Place:
+          frame = adapter.place(places[event.index]);
+          break;
+        case WorkloadKind::Edit:
+          frame = adapter.edit(edits[event.index]);
+          break;
+        case WorkloadKind::Cancel:
+          frame = adapter.cancel(cancels[event.index]);
+          break;
+      }
+      latency.stop(t0);
+      bytes += frame.size();
+    }
+  }
+  const double elapsed_s =
+      static_cast<double>(TscClock::now_ns() - begin_ns) / 1e9;
+
+  const double messages = static_cast<double>(latency.count());
+  std::printf("%-4s %10.0f %8lu %8lu %8lu %8lu %8lu %12.0f %10.1f\n",
+              Adapter::NAME, messages, latency.percentile_ns(50.0),
+              latency.percentile_ns(90.0), latency.percentile_ns(99.0),
+              latency.percentile_ns(99.9), latency.histogram().max(),
+              messages / elapsed_s, static_cast<double>(bytes) / messages);
+}
+
+// Field shapes of the log, the numbers the fixed TestData payloads stand
+// in for
+static void print_profile(const OrderLog& log) {
+  const WorkloadStream& stream = log.stream;
+  HdrHistogram<> instrument_len, label_len, order_id_len, price_decimals;
+  // Digits after the point in the shortest round-trip spelling
+  auto decimals = [](double value) -> uint64_t {
+    char buf[32];
+    const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    const std::string_view text(buf, end - buf);
+    const size_t dot = text.find('.');
+    return dot == std::string_view::npos ? 0 : text.size() - dot - 1;
+  };
+  for (const auto& p : stream.places) {
+    instrument_len.record(p.instrument_name.size());
+    label_len.record(p.label.size());
+    price_decimals.record(decimals(p.price));
+  }
+  for (const auto& e : stream.edits) {
+    order_id_len.record(e.order_id.size());
+    price_decimals.record(decimals(e.price));
+  }
+  for (const auto& c : stream.cancels) order_id_len.record(c.order_id.size());
+
+  const double span_s =
+      static_cast<double>(log.timestamps_ns.back() - log.timestamps_ns.front()) /
+      1e9;
+  std::printf("%zu events (%zu place, %zu edit, %zu cancel) over %.3f s\n",
+              stream.events.size(), stream.places.size(), stream.edits.size(),
+              stream.cancels.size(), span_s);
+  std::printf("%-16s %6s %6s %6s %6s\n", "field", "min", "p50", "p99", "max");
+  auto row = [](const char* name, const HdrHistogram<>& h) {
+    if (h.count() == 0) return;
+    std::printf("%-16s %6lu %6lu %6lu %6lu\n", name, h.min(),
+                h.percentile(50.0), h.percentile(99.0), h.max());
+  };
+  row("instrument_name", instrument_len);
+  row("label", label_len);
+  row("order_id", order_id_len);
+  row("price decimals", price_decimals);
+  std::printf("\n");
+}
+
+static int synthesize(size_t count, const char* path) {
+  WorkloadGenerator generator;
+  const WorkloadStream stream = generator.generate(count);
+  OrderLogWriter writer;
+  if (!writer.open(path)) {
+    std::fprintf(stderr, "cannot create %s: %s\n", path, std::strerror(errno));
+    return 1;
+  }
+
+  // Poisson arrivals, 20k messages per second on average
+  std::mt19937_64 rng(7);
+  std::exponential_distribution<double> gap_ns(1.0 / 50000.0);
+  uint64_t now_ns = 0;
+  for (const WorkloadEvent& event : stream.events) {
+    now_ns += static_cast<uint64_t>(gap_ns(rng));
+    switch (event.kind) {
+      case WorkloadKind::Place:
+        writer.record(stream.places[event.index], now_ns);
+        break;
+      case WorkloadKind::Edit:
+        writer.record(stream.edits[event.index], now_ns);
+        break;
+      case WorkloadKind::Cancel:
+        writer.record(stream.cancels[event.index], now_ns);
+        break;
+    }
+  }
+  if (!writer.close()) {
+    std::fprintf(stderr, "cannot write %s: %lu blocks (%lu bytes) lost\n",
+                 path, writer.failed_writes(), writer.lost_bytes());
+    return 1;
+  }
+  std::printf("wrote %lu records to %s\n", writer.records(), path);
+  if (writer.rejected() > 0) {
+    std::fprintf(stderr, "%lu records with an over-long string left out\n",
+                 writer.rejected());
+  }
+  return 0;
+}
+
+static void usage() {
+  std::fprintf(stderr,
+               "usage: json_serializer_replay <log> [--version v1|v2|v3|v4|all]"
+               " [--paced] [--speed X] [--repeat N]\n"
+               "       json_serializer_replay --synthesize <count> <log>\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc == 4 && std::strcmp(argv[1], "--synthesize") == 0) {
+    return synthesize(std::strtoull(argv[2], nullptr, 10), argv[3]);
+  }
+
+  ReplayOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (arg == "--version" && i + 1 < argc) {
+      options.version = argv[++i];
+    } else if (arg == "--paced") {
+      options.paced = true;
+    } else if (arg == "--speed" && i + 1 < argc) {
+      options.speed = std::strtod(argv[++i], nullptr);
+    } else if (arg == "--repeat" && i + 1 < argc) {
+      options.repeat = std::atoi(argv[++i]);
+    } else if (!arg.starts_with("--") && !options.path) {
+      options.path = argv[i];
+    } else {
+      usage();
+      return 1;
+    }
+  }
+  if (!options.path || options.speed <= 0.0 || options.repeat < 1) {
+    usage();
+    return 1;
+  }
+
+  std::string error;
+  const std::optional<OrderLog> log = OrderLogReader::load(options.path, &error);
+  if (!log) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  if (log->dropped_records > 0) {
+    std::fprintf(stderr,
+                 "%s: %lu malformed or truncated records dropped, the first "
+                 "at byte %lu\n",
+                 options.path, log->dropped_records,
+                 log->first_dropped_offset);
+  }
+  if (log->stream.events.empty()) {
+    std::fprintf(stderr, "%s has no records\n", options.path);
+    return 1;
+  }
+
+  print_profile(*log);
+  if (options.paced) {
+    std::printf("paced replay at %gx\n", options.speed);
+  } else {
+    std::printf("flat out replay\n");
+  }
+  std::printf("%-4s %10s %8s %8s %8s %8s %8s %12s %10s\n", "ver", "messages",
+              "p50_ns", "p90_ns", "p99_ns", "p999_ns", "max_ns", "msgs/s",
+              "bytes/msg");
+
+  const std::string& v = options.version;
+  if (v == "all" || v == "v1") replay<V1Adapter>(*log, options);
+  if (v == "all" || v == "v2") replay<V2Adapter>(*log, options);
+  if (v == "all" || v == "v3") replay<V3Adapter>(*log, options);
+  if (v == "all" || v == "v4") replay<V4Adapter>(*log, options);
+  return 0;
+}
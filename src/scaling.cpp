@@ -0,0 +1,186 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/cpu_affinity.h"
+#include "common/latency_recorder.h"
+#include "common/results.h"
+#include "common/tsc_clock.h"
+#include "common/workload.h"
+#include "unified_adapters.h"
+
+// N serializer instances of one version, one per pinned thread, running
+// concurrently over the same generated place stream. Each thread also
+// publishes a message count after every message, the way a monitoring
+// counter would.
+//
+// Layouts:
+//   padded  every instance and every counter starts its own 128 byte block
+//           (two lines, past the adjacent-line prefetcher)
+//   packed  instances back to back at sizeof(Adapter), counters in one
+//           uint64_t array
+// A packed run slower than its padded twin means some per-message write
+// shares a line with a neighbour's data, i.e. false sharing.
+
+enum class Layout { Padded, Packed };
+static constexpr const char* LAYOUT_NAMES[] = {"padded", "packed"};
+
+static constexpr size_t MESSAGES_PER_THREAD = 20000;
+static constexpr size_t BLOCK = 128;
+
+static const WorkloadStream& stream() {
+  static const WorkloadStream places{WorkloadGenerator().places(4096), {}, {},
+                                     {}};
+  return places;
+}
+
+// Raw storage for count objects of type T at the layout's stride
+template <typename T>
+class Slots {
+ public:
+  Slots(size_t count, Layout layout)
+      : count_(count),
+        stride_(layout == Layout::Padded
+                    ? (sizeof(T) + BLOCK - 1) / BLOCK * BLOCK
+                    : sizeof(T)),
+        storage_(static_cast<std::byte*>(::operator new(
+            stride_ * count, std::align_val_t{BLOCK}))) {
+    for (size_t i = 0; i < count_; ++i) new (storage_ + i * stride_) T();
+  }
+
+  ~Slots() {
+    for (size_t i = 0; i < count_; ++i) (*this)[i].~T();
+    ::operator delete(storage_, std::align_val_t{BLOCK});
+  }
+
+  Slots(const Slots&) = delete;
+  Slots& operator=(const Slots&) = delete;
+
+  T& operator[](size_t i) {
+    return *std::launder(reinterpret_cast<T*>(storage_ + i * stride_));
+  }
+
+ private:
+  size_t count_;
+  size_t stride_;
+  std::byte* storage_;
+};
+
+// Single-thread msgs/s per layout and version, for the scaling factor
+static std::map<std::string, double>& baselines() {
+  static std::map<std::string, double> baselines;
+  return baselines;
+}
+
+template <typename Adapter>
+static void BM_Scaling(benchmark::State& state, Layout layout) {
+  const size_t threads = state.range(0);
+  const WorkloadStream& source = stream();
+  std::vector<typename Adapter::PlaceRequest> places;
+  places.reserve(source.places.size());
+  for (const auto& p : source.places) places.push_back(Adapter::make_place(p));
+
+  Slots<Adapter> adapters(threads, layout);
+  Slots<uint64_t> counters(threads, layout);
+  // Recorders are written every message too; they stay padded so only the
+  // layout under test differs
+  Slots<LatencyRecorder> latency(threads, Layout::Padded);
+  std::vector<uint64_t> started(threads), finished(threads);
+  double elapsed_s = 0.0;
+
+  for (auto _ : state) {
+    std::barrier sync(static_cast<ptrdiff_t>(threads));
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+      workers.emplace_back([&, t]() {
+        pin_to_cpu(static_cast<unsigned>(t));
+        Adapter& adapter = adapters[t];
+        uint64_t& counter = counters[t];
+        LatencyRecorder& recorder = latency[t];
+        const size_t mask = places.size() - 1;
+        sync.arrive_and_wait();
+
+        started[t] = TscClock::now();
+        for (size_t i = 0; i < MESSAGES_PER_THREAD; ++i) {
+          const uint64_t t0 = recorder.start();
+          auto frame = adapter.place(places[(i + t * 977) & mask]);
+          benchmark::DoNotOptimize(frame.data());
+          recorder.stop(t0);
+          std::atomic_ref<uint64_t>(counter).store(
+              counter + 1, std::memory_order_relaxed);
+        }
+        finished[t] = TscClock::now();
+      });
+    }
+    for (auto& worker : workers) worker.join();
+
+    const uint64_t begin = *std::min_element(started.begin(), started.end());
+    const uint64_t end = *std::max_element(finished.begin(), finished.end());
+    const double seconds =
+        static_cast<double>(TscClock::calibration().to_ns(end - begin)) / 1e9;
+    elapsed_s += seconds;
+    state.SetIterationTime(seconds);
+  }
+
+  const double messages =
+      static_cast<double>(state.iterations() * threads * MESSAGES_PER_THREAD);
+  const double rate = elapsed_s > 0.0 ? messages / elapsed_s : 0.0;
+  state.counters["msgs/s"] = rate;
+
+  uint64_t worst = 0;
+  for (size_t t = 0; t < threads; ++t) {
+    const uint64_t p99 = latency[t].percentile_ns(99.0);
+    worst = std::max(worst, p99);
+    state.counters["p99_ns_t" + std::to_string(t)] = p99;
+  }
+  state.counters["p99_ns_worst"] = worst;
+
+  // Speedup over the one-thread run of the same layout and version, which
+  // is registered first
+  const std::string key =
+      std::string(LAYOUT_NAMES[static_cast<int>(layout)]) + "/" + Adapter::NAME;
+  if (threads == 1) baselines()[key] = rate;
+  if (auto it = baselines().find(key); it != baselines().end() && it->second) {
+    state.counters["scaling"] = rate / it->second;
+  }
+}
+
+template <typename Adapter>
+static void register_version() {
+  unsigned max_threads = std::max(2u, std::thread::hardware_concurrency());
+  for (Layout layout : {Layout::Padded, Layout::Packed}) {
+    const std::string name = std::string("BM_Scaling/") +
+                             LAYOUT_NAMES[static_cast<int>(layout)] + "/" +
+                             Adapter::NAME;
+    auto* bench = benchmark::RegisterBenchmark(name.c_str(),
+                                               BM_Scaling<Adapter>, layout);
+    unsigned n = 1;
+    for (; n <= max_threads; n *= 2) bench->Arg(n);
+    // Always measure the full machine, power of two or not
+    if (n / 2 != max_threads) bench->Arg(max_threads);
+    bench->ArgName("threads")->Iterations(5)->UseManualTime();
+  }
+}
+
+int main(int argc, char** argv) {
+  register_version<V1Adapter>();
+  register_version<V2Adapter>();
+  register_version<V3Adapter>();
+  register_version<V4Adapter>();
+
+  results::init("scaling", argc, argv);
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/trace.h"
+#include "v3.h"
+
+// Converts a trace::dump() file into Chrome trace-event JSON, for
+// chrome://tracing or ui.perfetto.dev. The JSON is written with the v3
+// DeribitJsonRpc writer.
+//
+//   trace_to_chrome <trace> [out.json]
+
+using v3::Buffer;
+using v3::DeribitJsonRpc;
+
+struct ThreadTrace {
+  uint32_t tid;
+  std::string name;
+  std::vector<TraceEvent> events;
+};
+
+class TraceFile {
+ public:
+  bool load(const char* path) {
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file) {
+      error_ = std::string("cannot open ") + path + ": " + std::strerror(errno);
+      return false;
+    }
+    const bool ok = parse(file);
+    std::fclose(file);
+    return ok;
+  }
+
+  [[nodiscard]] const std::string& error() const { return error_; }
+  [[nodiscard]] const TscCalibration& calibration() const {
+    return calibration_;
+  }
+  [[nodiscard]] const std::vector<ThreadTrace>& threads() const {
+    return threads_;
+  }
+
+ private:
+  bool parse(std::FILE* file) {
+    auto get = [&](void* out, size_t size) {
+      return std::fread(out, 1, size, file) == size;
+    };
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    if (!get(magic, sizeof(magic)) ||
+        std::memcmp(magic, trace::MAGIC, sizeof(magic)) != 0 ||
+        !get(&version, sizeof(version))) {
+      error_ = "not a trace file";
+      return false;
+    }
+    if (version != trace::VERSION) {
+      error_ = "unsupported trace version " + std::to_string(version);
+      return false;
+    }
+    if (!get(&calibration_.mult, sizeof(calibration_.mult)) ||
+        !get(&count, sizeof(count))) {
+      error_ = "truncated header";
+      return false;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+      ThreadTrace thread;
+      uint32_t name_len = 0;
+      uint64_t events = 0;
+      if (!get(&thread.tid, sizeof(thread.tid)) ||
+          !get(&name_len, sizeof(name_len))) {
+        error_ = "truncated thread header";
+        return false;
+      }
+      thread.name.resize(name_len);
+      if (!get(thread.name.data(), name_len) || !get(&events, sizeof(events))) {
+        error_ = "truncated thread header";
+        return false;
+      }
+      thread.events.resize(events);
+      if (!get(thread.events.data(), events * sizeof(TraceEvent))) {
+        error_ = "truncated events for thread " + thread.name;
+        return false;
+      }
+      threads_.push_back(std::move(thread));
+    }
+    return true;
+  }
+
+  std::string error_;
+  TscCalibration calibration_{};
+  std::vector<ThreadTrace> threads_;
+};
+
+// {"displayTimeUnit":"ns","traceEvents":[...]}, timestamps in microseconds
+// from the earliest event of any thread
+static void write_chrome_json(const TraceFile& trace, Buffer& out) {
+  uint64_t origin = UINT64_MAX;
+  for (const ThreadTrace& thread : trace.threads()) {
+    if (!thread.events.empty()) {
+      origin = std::min(origin, thread.events.front().tsc);
+    }
+  }
+
+  DeribitJsonRpc<Buffer> json(out);
+  json.begin_object();
+  json.serialize("displayTimeUnit", "ns");
+  json.serialize_fragment("\"traceEvents\":");
+  json.begin_array();
+  bool first = true;
+  auto next_event = [&]() {
+    if (!first) out.append(',');
+    first = false;
+    json.begin_object();
+  };
+
+  for (const ThreadTrace& thread : trace.threads()) {
+    const int64_t tid = thread.tid;
+    next_event();
+    json.serialize("name", "thread_name");
+    json.serialize("ph", "M");
+    json.serialize("pid", 1);
+    json.serialize("tid", tid);
+    json.serialize_fragment("\"args\":");
+    json.begin_object();
+    json.serialize("name", thread.name);
+    json.end_object();
+    json.end_object();
+
+    // A ring that wrapped may start with the end of a scope whose begin
+    // was overwritten; skip those so the viewer does not mis-nest
+    int depth = 0;
+    for (const TraceEvent& event : thread.events) {
+      if (event.phase == TracePhase::End && depth == 0) continue;
+      depth += event.phase == TracePhase::Begin;
+      depth -= event.phase == TracePhase::End;
+
+      const char phase[2] = {static_cast<char>(event.phase), '\0'};
+      const uint64_t ns = trace.calibration().to_ns(event.tsc - origin);
+      next_event();
+      json.serialize("name",
+                     TRACE_STAGE_NAMES[static_cast<size_t>(event.stage)]);
+      json.serialize("cat", "order_path");
+      json.serialize("ph", phase);
+      json.serialize("ts", static_cast<double>(ns) / 1000.0);
+      json.serialize("pid", 1);
+      json.serialize("tid", tid);
+      if (event.phase == TracePhase::Instant) json.serialize("s", "t");
+      json.serialize_fragment("\"args\":");
+      json.begin_object();
+      json.serialize("arg", static_cast<int64_t>(event.arg));
+      json.end_object();
+      json.end_object();
+    }
+  }
+
+  json.end_array();
+  json.end_object();
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    std::fprintf(stderr, "usage: trace_to_chrome <trace> [out.json]\n");
+    return 1;
+  }
+
+  TraceFile trace;
+  if (!trace.load(argv[1])) {
+    std::fprintf(stderr, "%s\n", trace.error().c_str());
+    return 1;
+  }
+
+  size_t events = 0;
+  for (const ThreadTrace& thread : trace.threads()) {
+    events += thread.events.size();
+  }
+  Buffer out(256 + events * 160);
+  write_chrome_json(trace, out);
+
+  std::FILE* file = argc == 3 ? std::fopen(argv[2], "wb") : stdout;
+  if (!file) {
+    std::fprintf(stderr, "cannot create %s: %s\n", argv[2],
+                 std::strerror(errno));
+    return 1;
+  }
+  const bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+  if (file != stdout) std::fclose(file);
+  if (!ok) {
+    std::fprintf(stderr, "write failed\n");
+    return 1;
+  }
+  if (argc == 3) {
+    std::fprintf(stderr, "%zu events from %zu threads written to %s\n", events,
+                 trace.threads().size(), argv[2]);
+  }
+  return 0;
+}
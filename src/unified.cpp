@@ -0,0 +1,387 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/alloc_counter.h"
+#include "common/cache_control.h"
+#include "common/json_equal.h"
+#include "common/latency_recorder.h"
+#include "common/perf_counters.h"
+#include "common/results.h"
+#include "common/workload.h"
+#include "unified_adapters.h"
+
+// Every serializer generation on the same canonical place, edit and cancel
+// payloads and generated streams. Output is checked against v3 before
+// anything is timed, then a table of ns per message is printed after the
+// runs.
+
+enum class Workload { Place, Edit, Cancel, Mixed };
+static constexpr const char* WORKLOAD_NAMES[] = {"place", "edit", "cancel",
+                                                 "mixed"};
+
+template <typename Adapter>
+static std::string_view serialize(Adapter& adapter, Workload workload) {
+  static const auto place = Adapter::make_place(canonical::place());
+  static const auto edit = Adapter::make_edit(canonical::edit());
+  static const auto cancel = Adapter::make_cancel(canonical::cancel());
+  switch (workload) {
+    case Workload::Place:
+      return adapter.place(place);
+    case Workload::Edit:
+      return adapter.edit(edit);
+    case Workload::Cancel:
+    case Workload::Mixed:
+      return adapter.cancel(cancel);
+  }
+  return {};
+}
+
+// First frame of a fresh adapter, so every version uses request id 1
+template <typename Adapter>
+static std::string first_frame(Workload workload) {
+  Adapter adapter;
+  return std::string(serialize(adapter, workload));
+}
+
+struct VersionOutput {
+  const char* version;
+  std::string frame;
+};
+
+template <typename... Adapters>
+static std::vector<VersionOutput> outputs(Workload workload) {
+  return {VersionOutput{Adapters::NAME, first_frame<Adapters>(workload)}...};
+}
+
+// Compare every version with v3. Returns false if any output differs in
+// meaning; byte differences alone (key order, number spelling) are noted.
+static bool verify_outputs() {
+  bool ok = true;
+  std::cout << "======== OUTPUT CHECK (reference v3) ========\n";
+  for (Workload workload : {Workload::Place, Workload::Edit, Workload::Cancel}) {
+    auto frames =
+        outputs<V1Adapter, V2Adapter, V3Adapter, V4Adapter>(workload);
+    const std::string& reference = frames[2].frame;
+    for (const auto& [version, frame] : frames) {
+      const char* verdict = "identical";
+      if (frame != reference) {
+        verdict = json_equal(frame, reference) ? "equivalent" : "DIFFERENT";
+      }
+      std::printf("%-7s %-3s %-10s %s\n", WORKLOAD_NAMES[static_cast<int>(workload)],
+                  version, verdict, frame.c_str());
+      if (verdict[0] == 'D') ok = false;
+    }
+  }
+  std::cout << std::endl;
+  return ok;
+}
+
+template <typename Adapter>
+static void BM_Unified(benchmark::State& state, Workload workload) {
+  Adapter adapter;
+  size_t bytes = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    auto frame = serialize(adapter, workload);
+    bytes += frame.size();
+    benchmark::DoNotOptimize(frame.data());
+    benchmark::ClobberMemory();
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.SetBytesProcessed(bytes);
+}
+
+// Generated traffic shared by every version, so each one sees the same
+// prices, names and labels in the same order
+static constexpr size_t STREAM_SIZE = 4096;  // power of two, for masking
+
+static const WorkloadStream& stream() {
+  static const WorkloadStream workload = WorkloadGenerator().generate(STREAM_SIZE);
+  return workload;
+}
+
+static const WorkloadStream& stream_of(Workload kind) {
+  static const WorkloadStream places{WorkloadGenerator().places(STREAM_SIZE), {}, {},
+                               {}};
+  static const WorkloadStream edits{{}, WorkloadGenerator().edits(STREAM_SIZE), {},
+                              {}};
+  return kind == Workload::Place ? places : kind == Workload::Edit ? edits
+                                                                   : stream();
+}
+
+// A workload's generated stream converted to one version's request types.
+// Cancels cover every order the mixed stream cancels, so they are taken
+// from that stream.
+template <typename Adapter>
+struct StreamInput {
+  explicit StreamInput(Workload kind)
+      : workload(kind),
+        places(convert(stream_of(kind).places, Adapter::make_place)),
+        edits(convert(stream_of(kind).edits, Adapter::make_edit)),
+        cancels(convert(stream_of(kind).cancels, Adapter::make_cancel)),
+        events(stream_of(kind).events) {}
+
+  // Messages in one pass over the stream
+  [[nodiscard]] size_t size() const {
+    return workload == Workload::Cancel ? cancels.size() : STREAM_SIZE;
+  }
+
+  // Message i of the stream, wrapping around
+  std::string_view serialize(Adapter& adapter, size_t i) const {
+    switch (workload) {
+      case Workload::Place:
+        return adapter.place(places[i & (places.size() - 1)]);
+      case Workload::Edit:
+        return adapter.edit(edits[i & (edits.size() - 1)]);
+      case Workload::Cancel:
+        return adapter.cancel(cancels[i % cancels.size()]);
+      case Workload::Mixed: {
+        const WorkloadEvent& event = events[i & (events.size() - 1)];
+        switch (event.kind) {
+          case WorkloadKind::Place:
+            return adapter.place(places[event.index]);
+          case WorkloadKind::Edit:
+            return adapter.edit(edits[event.index]);
+          case WorkloadKind::Cancel:
+            return adapter.cancel(cancels[event.index]);
+        }
+        break;
+      }
+    }
+    return {};
+  }
+
+  Workload workload;
+  std::vector<typename Adapter::PlaceRequest> places;
+  std::vector<typename Adapter::EditRequest> edits;
+  std::vector<typename Adapter::CancelRequest> cancels;
+  const std::vector<WorkloadEvent>& events;
+};
+
+// One pass over a stream from a fresh adapter
+template <typename Adapter>
+static std::vector<std::string> stream_frames(Workload workload) {
+  const StreamInput<Adapter> input(workload);
+  Adapter adapter;
+  std::vector<std::string> frames;
+  frames.reserve(input.size());
+  for (size_t i = 0; i < input.size(); ++i) {
+    frames.emplace_back(input.serialize(adapter, i));
+  }
+  return frames;
+}
+
+// Every frame of every generated stream against v3, so no version is timed
+// on output the others would not produce. Returns false on any frame that
+// differs in meaning and prints the first one per version.
+static bool verify_streams() {
+  bool ok = true;
+  std::cout << "======== STREAM CHECK (reference v3) ========\n";
+  for (Workload workload : {Workload::Place, Workload::Edit, Workload::Cancel,
+                            Workload::Mixed}) {
+    const std::vector<std::string> reference = stream_frames<V3Adapter>(workload);
+    const std::pair<const char*, std::vector<std::string>> versions[] = {
+        {V1Adapter::NAME, stream_frames<V1Adapter>(workload)},
+        {V2Adapter::NAME, stream_frames<V2Adapter>(workload)},
+        {V4Adapter::NAME, stream_frames<V4Adapter>(workload)}};
+    for (const auto& [version, frames] : versions) {
+      size_t different = 0;
+      size_t first = 0;
+      for (size_t i = 0; i < frames.size(); ++i) {
+        if (frames[i] == reference[i] || json_equal(frames[i], reference[i])) {
+          continue;
+        }
+        if (different++ == 0) first = i;
+      }
+      std::printf("%-7s %-3s %-10s %zu of %zu frames differ\n",
+                  WORKLOAD_NAMES[static_cast<int>(workload)], version,
+                  different == 0 ? "equivalent" : "DIFFERENT", different,
+                  frames.size());
+      if (different > 0) {
+        std::printf("  %s\n  v3: %s\n", frames[first].c_str(),
+                    reference[first].c_str());
+        ok = false;
+      }
+    }
+  }
+  std::cout << std::endl;
+  return ok;
+}
+
+// Same as BM_Unified but over the generated stream, converted to each
+// version's request types before timing
+template <typename Adapter>
+static void BM_UnifiedStream(benchmark::State& state, Workload workload) {
+  const StreamInput<Adapter> input(workload);
+  Adapter adapter;
+  size_t bytes = 0;
+  size_t i = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    auto frame = input.serialize(adapter, i++);
+    bytes += frame.size();
+    benchmark::DoNotOptimize(frame.data());
+    benchmark::ClobberMemory();
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.SetBytesProcessed(bytes);
+}
+
+// One message per iteration, timed on its own with the caches put in mode
+// first. Warm uses the same single-shot timing so the three modes compare
+// directly; BM_Unified is the warm loop for throughput.
+template <typename Adapter>
+static void BM_UnifiedCache(benchmark::State& state, Workload workload,
+                            CacheMode mode) {
+  Adapter adapter;
+  CacheThrasher thrasher(mode);
+  LatencyRecorder latency;
+  serialize(adapter, workload);  // first-call setup is not what is measured
+
+  for (auto _ : state) {
+    thrasher.apply();
+    const uint64_t t0 = latency.start();
+    auto frame = serialize(adapter, workload);
+    benchmark::DoNotOptimize(frame.data());
+    const uint64_t t1 = TscClock::stop();
+    const uint64_t ns = TscClock::calibration().to_ns(t1 - t0);
+    latency.record_ns(static_cast<int64_t>(ns));
+    state.SetIterationTime(static_cast<double>(ns) / 1e9);
+  }
+
+  latency.report_to(state);
+}
+
+template <typename Adapter>
+static void register_version() {
+  for (Workload workload : {Workload::Place, Workload::Edit, Workload::Cancel}) {
+    const std::string name = std::string("BM_Unified/") +
+                             WORKLOAD_NAMES[static_cast<int>(workload)] + "/" +
+                             Adapter::NAME;
+    benchmark::RegisterBenchmark(name.c_str(), BM_Unified<Adapter>, workload);
+  }
+  for (Workload workload : {Workload::Place, Workload::Edit, Workload::Cancel,
+                            Workload::Mixed}) {
+    const std::string name = std::string("BM_UnifiedStream/") +
+                             WORKLOAD_NAMES[static_cast<int>(workload)] + "/" +
+                             Adapter::NAME;
+    benchmark::RegisterBenchmark(name.c_str(), BM_UnifiedStream<Adapter>,
+                                 workload);
+  }
+  // Shots are slow to set up when cold, so iterations are fixed
+  for (CacheMode mode : {CacheMode::Warm, CacheMode::Polluted, CacheMode::Cold}) {
+    for (Workload workload :
+         {Workload::Place, Workload::Edit, Workload::Cancel}) {
+      const std::string name = std::string("BM_UnifiedCache/") +
+                               CACHE_MODE_NAMES[static_cast<int>(mode)] + "/" +
+                               WORKLOAD_NAMES[static_cast<int>(workload)] +
+                               "/" + Adapter::NAME;
+      benchmark::RegisterBenchmark(name.c_str(), BM_UnifiedCache<Adapter>,
+                                   workload, mode)
+          ->UseManualTime()
+          ->Iterations(mode == CacheMode::Cold ? 100 : 1000);
+    }
+  }
+}
+
+// Console output as usual, plus the CPU time of every run kept for the
+// comparison table
+class ComparisonReporter : public benchmark::ConsoleReporter {
+ public:
+  void ReportRuns(const std::vector<Run>& runs) override {
+    ConsoleReporter::ReportRuns(runs);
+    for (const Run& run : runs) {
+      if (run.error_occurred || run.run_type != Run::RT_Iteration) continue;
+      // BM_Unified/<workload>/<version>, BM_UnifiedStream/... as
+      // stream/<workload> and BM_UnifiedCache/<mode>/<workload>/<version>
+      // as <mode>/<workload>, timed manually
+      std::string name = run.benchmark_name();
+      const bool manual_time = name.ends_with("/manual_time");
+      if (manual_time) name.resize(name.size() - std::string_view("/manual_time").size());
+      if (const size_t at = name.find("/iterations:");
+          at != std::string::npos) {
+        name.resize(at);
+      }
+      const size_t family_at = name.find('/');
+      const size_t version_at = name.rfind('/');
+      if (family_at == std::string::npos || version_at == family_at) continue;
+      std::string workload =
+          name.substr(family_at + 1, version_at - family_at - 1);
+      if (name.starts_with("BM_UnifiedStream/")) workload = "stream/" + workload;
+      const std::string version = name.substr(version_at + 1);
+      ns_[workload][version] = manual_time ? run.GetAdjustedRealTime()
+                                           : run.GetAdjustedCPUTime();
+    }
+  }
+
+  void print_table() const {
+    std::printf("\n%-16s", "ns/msg");
+    for (const char* version : VERSIONS) std::printf("%10s", version);
+    std::printf("%12s\n", "v4 vs v1");
+    for (const char* prefix : {"", "stream/", "warm/", "polluted/", "cold/"}) {
+      for (const char* workload : WORKLOAD_NAMES) {
+        print_row(std::string(prefix) + workload);
+      }
+    }
+  }
+
+ private:
+  static constexpr const char* VERSIONS[] = {"v1", "v2", "v3", "v4"};
+
+  void print_row(const std::string& workload) const {
+    auto row = ns_.find(workload);
+    if (row == ns_.end()) return;
+    std::printf("%-16s", workload.c_str());
+    for (const char* version : VERSIONS) {
+      auto cell = row->second.find(version);
+      if (cell == row->second.end()) {
+        std::printf("%10s", "-");
+      } else {
+        std::printf("%10.1f", cell->second);
+      }
+    }
+    auto v1 = row->second.find("v1");
+    auto v4 = row->second.find("v4");
+    if (v1 != row->second.end() && v4 != row->second.end() && v4->second > 0) {
+      std::printf("%11.2fx", v1->second / v4->second);
+    }
+    std::printf("\n");
+  }
+
+  std::map<std::string, std::map<std::string, double>> ns_;
+};
+
+int main(int argc, char** argv) {
+  if (!verify_outputs() || !verify_streams()) {
+    std::cerr << "Serializer outputs disagree; not benchmarking\n";
+    return 1;
+  }
+
+  register_version<V1Adapter>();
+  register_version<V2Adapter>();
+  register_version<V3Adapter>();
+  register_version<V4Adapter>();
+
+  results::init("unified", argc, argv);
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ComparisonReporter reporter;
+  ::benchmark::RunSpecifiedBenchmarks(&reporter);
+  ::benchmark::Shutdown();
+  reporter.print_table();
+  return 0;
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/canonical.h"
+#include "v1.h"
+#include "v2.h"
+#include "v3.h"
+#include "v4.h"
+
+// Each adapter converts the canonical payloads into its generation's own
+// request types once (make_*), then serializes those with place, edit and
+// cancel. Request ids count up from 1 on every adapter, like
+// DeribitClient, so fresh adapters produce the same frames.
+
+// A list of canonical payloads in one generation's request types, e.g.
+// convert(stream.places, V3Adapter::make_place), done before timing
+template <typename Canonical, typename MakeFn>
+auto convert(const std::vector<Canonical>& in, MakeFn make) {
+  std::vector<decltype(make(in.front()))> out;
+  out.reserve(in.size());
+  for (const auto& item : in) out.push_back(make(item));
+  return out;
+}
+
+// v1 has no JSON-RPC envelope; it is written around a v1 Schema for params
+class V1Adapter {
+ public:
+  static constexpr const char* NAME = "v1";
+
+  using PlaceRequest = canonical::Place;
+  using EditRequest = canonical::Edit;
+  using CancelRequest = canonical::Cancel;
+
+  static PlaceRequest make_place(const canonical::Place& p) { return p; }
+  static EditRequest make_edit(const canonical::Edit& e) { return e; }
+  static CancelRequest make_cancel(const canonical::Cancel& c) { return c; }
+
+  V1Adapter() : buffer_(4096), request_id_(1) {}
+
+  std::string_view place(const PlaceRequest& req) {
+    return write("private/buy", req, [](const auto& r, auto& s) {
+      PlaceSchema::serialize(r, s);
+    });
+  }
+
+  std::string_view edit(const EditRequest& req) {
+    return write("private/edit", req, [](const auto& r, auto& s) {
+      EditSchema::serialize(r, s);
+    });
+  }
+
+  std::string_view cancel(const CancelRequest& req) {
+    return write("private/cancel", req, [](const auto& r, auto& s) {
+      CancelSchema::serialize(r, s);
+    });
+  }
+
+ private:
+  using P = canonical::Place;
+  using E = canonical::Edit;
+  using C = canonical::Cancel;
+  using PlaceSchema = v1::Schema<
+      v1::Field<P, canonical::fields::INSTRUMENT_NAME, std::string,
+                &P::instrument_name>,
+      v1::Field<P, canonical::fields::AMOUNT, double, &P::amount>,
+      v1::Field<P, canonical::fields::PRICE, double, &P::price>,
+      v1::Field<P, canonical::fields::TYPE, std::string, &P::type>,
+      v1::Field<P, canonical::fields::LABEL, std::string, &P::label>,
+      v1::Field<P, canonical::fields::REDUCE_ONLY, bool, &P::reduce_only>,
+      v1::Field<P, canonical::fields::POST_ONLY, bool, &P::post_only>,
+      v1::Field<P, canonical::fields::TIME_IN_FORCE, std::string,
+                &P::time_in_force>,
+      v1::Field<P, canonical::fields::MAX_SHOW, double, &P::max_show>>;
+  using EditSchema = v1::Schema<
+      v1::Field<E, canonical::fields::ORDER_ID, std::string, &E::order_id>,
+      v1::Field<E, canonical::fields::AMOUNT, double, &E::amount>,
+      v1::Field<E, canonical::fields::PRICE, double, &E::price>,
+      v1::Field<E, canonical::fields::POST_ONLY, bool, &E::post_only>,
+      v1::Field<E, canonical::fields::MAX_SHOW, double, &E::max_show>>;
+  using CancelSchema = v1::Schema<
+      v1::Field<C, canonical::fields::ORDER_ID, std::string, &C::order_id>>;
+
+  template <typename Request, typename WriteParams>
+  std::string_view write(const char* method, const Request& req,
+                         WriteParams&& write_params) {
+    buffer_.reset();
+    v1::JsonSerializer<v1::Buffer> envelope(buffer_);
+    envelope.begin_object();
+    envelope.serialize("jsonrpc", "2.0");
+    envelope.serialize("method", method);
+    envelope.serialize("id", static_cast<int64_t>(request_id_++));
+    buffer_.append(",\"params\":", 10);
+    v1::JsonSerializer<v1::Buffer> params(buffer_);
+    write_params(req, params);
+    envelope.end_object();
+    return std::string_view(buffer_.data(), buffer_.size());
+  }
+
+  v1::Buffer buffer_;
+  int request_id_;
+};
+
+// v2 and v3 serialize through their DeribitClient
+template <typename Client, typename Order, typename Edit, typename Cancel>
+class ClientAdapter {
+ public:
+  using PlaceRequest = Order;
+  using EditRequest = Edit;
+  using CancelRequest = Cancel;
+
+  static PlaceRequest make_place(const canonical::Place& p) {
+    return PlaceRequest{.instrument_name = p.instrument_name,
+                        .amount = p.amount,
+                        .price = p.price,
+                        .type = p.type,
+                        .label = p.label,
+                        .reduce_only = p.reduce_only,
+                        .post_only = p.post_only,
+                        .time_in_force = p.time_in_force,
+                        .max_show = p.max_show};
+  }
+
+  static EditRequest make_edit(const canonical::Edit& e) {
+    return EditRequest{.order_id = e.order_id,
+                       .amount = e.amount,
+                       .price = e.price,
+                       .post_only = e.post_only,
+                       .max_show = e.max_show};
+  }
+
+  static CancelRequest make_cancel(const canonical::Cancel& c) {
+    return CancelRequest{.order_id = c.order_id};
+  }
+
+  std::string_view place(const PlaceRequest& req) {
+    return client_.create_buy_request(req);
+  }
+
+  std::string_view edit(const EditRequest& req) {
+    return client_.create_edit_request(req);
+  }
+
+  std::string_view cancel(const CancelRequest& req) {
+    return client_.create_cancel_request(req);
+  }
+
+ private:
+  Client client_;
+};
+
+class V2Adapter
+    : public ClientAdapter<v2::DeribitClient, v2::DeribitOrderRequest,
+                           v2::DeribitEditRequest, v2::DeribitCancelRequest> {
+ public:
+  static constexpr const char* NAME = "v2";
+};
+
+class V3Adapter
+    : public ClientAdapter<v3::DeribitClient, v3::DeribitOrderRequest,
+                           v3::DeribitEditRequest, v3::DeribitCancelRequest> {
+ public:
+  static constexpr const char* NAME = "v3";
+};
+
+// v4 writes straight from string views, so the canonical payloads are its
+// native requests. Keys it has no tag for are declared here.
+class V4Adapter {
+  struct type_t {
+    constexpr static const char* name = "type";
+  };
+  struct max_show_t {
+    constexpr static const char* name = "max_show";
+  };
+
+  template <typename... Params>
+  using Request = v4::schema::object<
+      v4::schema::fixed_key_value<v4::jsonrpc_t>,
+      v4::schema::key_value<v4::method_t,
+                            v4::schema::string<v4::METHOD_PLACE_SIZE>>,
+      v4::schema::key_value<v4::request_id_t,
+                            v4::schema::number<v4::RequestID>>,
+      v4::schema::key_value<v4::params_t, v4::schema::object<Params...>>>;
+  template <typename Key, size_t N>
+  using String = v4::schema::key_value<Key, v4::schema::string<N>>;
+  template <typename Key>
+  using Number = v4::schema::key_value<Key, v4::schema::number<double>>;
+  template <typename Key>
+  using Boolean = v4::schema::key_value<Key, v4::schema::boolean>;
+
+  using PlaceSchema = Request<
+      String<v4::instrument_t, v4::INSTRUMENT_SIZE>, Number<v4::amount_t>,
+      Number<v4::price_t>, String<type_t, 16>, String<v4::label_t, 64>,
+      Boolean<v4::reduce_only_t>, Boolean<v4::post_only_t>,
+      String<v4::time_in_force_t, v4::TIF_SIZE>, Number<max_show_t>>;
+  using EditSchema =
+      Request<String<v4::order_id_t, 64>, Number<v4::amount_t>,
+              Number<v4::price_t>, Boolean<v4::post_only_t>,
+              Number<max_show_t>>;
+  using CancelSchema = Request<String<v4::order_id_t, 64>>;
+
+ public:
+  static constexpr const char* NAME = "v4";
+
+  using PlaceRequest = canonical::Place;
+  using EditRequest = canonical::Edit;
+  using CancelRequest = canonical::Cancel;
+
+  static PlaceRequest make_place(const canonical::Place& p) { return p; }
+  static EditRequest make_edit(const canonical::Edit& e) { return e; }
+  static CancelRequest make_cancel(const canonical::Cancel& c) { return c; }
+
+  V4Adapter() : serializer_(buffer_), request_id_(1) {}
+
+  std::string_view place(const PlaceRequest& req) {
+    using namespace v4;
+    return serializer_.write<PlaceSchema>([&](auto& w) {
+      w.template set<method_t>(std::string_view("private/buy"));
+      w.template set<request_id_t>(request_id_++);
+      w.template set<params_t, instrument_t>(
+          std::string_view(req.instrument_name));
+      w.template set<params_t, amount_t>(req.amount);
+      w.template set<params_t, price_t>(req.price);
+      w.template set<params_t, type_t>(std::string_view(req.type));
+      w.template set<params_t, label_t>(std::string_view(req.label));
+      w.template set<params_t, reduce_only_t>(req.reduce_only);
+      w.template set<params_t, post_only_t>(req.post_only);
+      w.template set<params_t, time_in_force_t>(
+          std::string_view(req.time_in_force));
+      w.template set<params_t, max_show_t>(req.max_show);
+    });
+  }
+
+  std::string_view edit(const EditRequest& req) {
+    using namespace v4;
+    return serializer_.write<EditSchema>([&](auto& w) {
+      w.template set<method_t>(std::string_view("private/edit"));
+      w.template set<request_id_t>(request_id_++);
+      w.template set<params_t, order_id_t>(std::string_view(req.order_id));
+      w.template set<params_t, amount_t>(req.amount);
+      w.template set<params_t, price_t>(req.price);
+      w.template set<params_t, post_only_t>(req.post_only);
+      w.template set<params_t, max_show_t>(req.max_show);
+    });
+  }
+
+  std::string_view cancel(const CancelRequest& req) {
+    using namespace v4;
+    return serializer_.write<CancelSchema>([&](auto& w) {
+      w.template set<method_t>(std::string_view("private/cancel"));
+      w.template set<request_id_t>(request_id_++);
+      w.template set<params_t, order_id_t>(std::string_view(req.order_id));
+    });
+  }
+
+ private:
+  v4::StaticBuffer<4096> buffer_;
+  v4::Serializer<v4::StaticBuffer<4096>> serializer_;
+  v4::RequestID request_id_;
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+namespace v1 {
+
+class Buffer {
+ public:
+  explicit Buffer(size_t capacity)
+      : data_(std::make_unique<char[]>(capacity)),
+        capacity_(capacity),
+        size_(0) {}
+
+  // Append Methods:
+  void append(const char* str, size_t len) {
+    if (size_ + len <= capacity_) {
+      std::memcpy(data_.get() + size_, str, len);
+      size_ += len;
+    }
+  }
+
+  void append(char c) {
+    if (size_ < capacity_) {
+      data_[size_++] = c;
+    }
+  }
+
+  void append(const char* str) { append(str, strlen(str)); }
+
+  // Reset buffer for reuse
+  void reset() { size_ = 0; }
+
+  // Accessor Methods:
+  char* current() { return data_.get() + size_; }
+  size_t remaining() const { return capacity_ - size_; }
+  const char* data() const { return data_.get(); }
+  size_t size() const { return size_; }
+
+ private:
+  std::unique_ptr<char[]> data_;
+  size_t capacity_;
+  size_t size_;
+};
+
+template <typename BufferType>
+class JsonSerializer {
+ private:
+  // Helper Method
+  void write_key(const char* key) {
+    if (!first_field_) {
+      buffer_.append(',');
+    } else {
+      first_field_ = false;
+    }
+    buffer_.append('"');
+    buffer_.append(key, strlen(key));
+    buffer_.append('"');
+    buffer_.append(':');
+  }
+  BufferType& buffer_;  // Reference to output buffer
+  bool first_field_;    // Tracks first field status for comma insertion
+
+ public:
+  explicit JsonSerializer(BufferType& buffer)
+      : buffer_(buffer), first_field_(true) {}
+
+  // Object Structure Methods
+  void begin_object() {
+    buffer_.append('{');
+    first_field_ = true;
+  }
+
+  void end_object() { buffer_.append('}'); }
+
+  // Serialization Methods by Type
+  void serialize(const char* key, const std::string& value) {
+    write_key(key);
+    buffer_.append('"');
+    for (char c : value) {
+      if (c == '"' || c == '\\') {
+        buffer_.append('\\');
+        buffer_.append(c);
+      } else if (c == '\n') {
+        buffer_.append('\\');
+        buffer_.append('n');
+      } else if (c == '\r') {
+        buffer_.append('\\');
+        buffer_.append('r');
+      } else if (c == '\t') {
+        buffer_.append('\\');
+        buffer_.append('t');
+      } else {
+        buffer_.append(c);
+      }
+    }
+    buffer_.append('"');
+  }
+
+  void serialize(const char* key, const char* value) {
+    write_key(key);
+    buffer_.append('"');
+    buffer_.append(value, strlen(value));
+    buffer_.append('"');
+  }
+
+  void serialize(const char* key, double value) {
+    write_key(key);
+    char buf[32];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    if (ec == std::errc()) {
+      buffer_.append(buf, ptr - buf);
+    }
+  }
+
+  void serialize(const char* key, int64_t value) {
+    write_key(key);
+    char buf[32];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    if (ec == std::errc()) {
+      buffer_.append(buf, ptr - buf);
+    }
+  }
+
+  void serialize(const char* key, bool value) {
+    write_key(key);
+    if (value) {
+      buffer_.append("true", 4);
+    } else {
+      buffer_.append("false", 5);
+    }
+  }
+};
+
+namespace fields {
+constexpr const char SYMBOL[] = "symbol";
+constexpr const char PRICE[] = "price";
+constexpr const char SIZE[] = "size";
+constexpr const char REQUEST_TYPE[] = "request_type";
+}  // namespace fields
+
+namespace constants {
+constexpr const char PLACE[] = "place";
+constexpr const char UPDATE[] = "update";
+constexpr const char CANCEL[] = "cancel";
+constexpr const char ORDER_ID[] = "order_id";
+constexpr const char IS_BUY[] = "is_buy";
+constexpr const char TIMESTAMP[] = "timestamp";
+constexpr const char ORDERS[] = "orders";
+}  // namespace constants
+
+template <typename T, const char* Name, typename Type, Type T::* Member>
+struct Field {
+  static constexpr const char* name = Name;
+
+  template <typename U>
+  static const Type& get(const U& obj) {
+    return static_cast<const T&>(obj).*Member;
+  }
+};
+
+template <typename T, const char* Name, const char* Value>
+struct ConstantField {
+  static constexpr const char* name = Name;
+
+  template <typename U>
+  static const char* get(const U&) {
+    return Value;
+  }
+};
+
+// Schema definition as a compile-time list of fields
+template <typename... Fields>
+struct Schema {
+  template <typename T, typename BufferType>
+  static void serialize(const T& obj, JsonSerializer<BufferType>& serializer) {
+    serializer.begin_object();
+    serialize_fields<0>(obj, serializer);
+    serializer.end_object();
+  }
+
+  template <size_t I, typename T, typename BufferType>
+  static void serialize_fields(const T& obj,
+                               JsonSerializer<BufferType>& serializer) {
+    if constexpr (I < sizeof...(Fields)) {
+      using FieldType = std::tuple_element_t<I, std::tuple<Fields...>>;
+      serializer.serialize(FieldType::name, FieldType::get(obj));
+      serialize_fields<I + 1>(obj, serializer);
+    }
+  }
+};
+
+// Simple request structure
+struct PlaceReq {
+  std::string symbol;
+  double price;
+  double size;
+};
+
+using PlaceReqSchema =
+    Schema<ConstantField<PlaceReq, fields::REQUEST_TYPE, constants::PLACE>,
+           Field<PlaceReq, fields::SYMBOL, std::string, &PlaceReq::symbol>,
+           Field<PlaceReq, fields::PRICE, double, &PlaceReq::price>,
+           Field<PlaceReq, fields::SIZE, double, &PlaceReq::size>>;
+
+// Serialize function for PlaceReq
+inline void serialize_place_req(Buffer& buf, const PlaceReq& req) {
+  JsonSerializer<Buffer> serializer(buf);
+  PlaceReqSchema::serialize(req, serializer);
+}
+
+// Additional request types for benchmarking
+struct UpdateReq {
+  std::string symbol;
+  std::string order_id;
+  double price;
+  double size;
+};
+
+using UpdateReqSchema = Schema<
+    ConstantField<UpdateReq, fields::REQUEST_TYPE, constants::UPDATE>,
+    Field<UpdateReq, fields::SYMBOL, std::string, &UpdateReq::symbol>,
+    Field<UpdateReq, constants::ORDER_ID, std::string, &UpdateReq::order_id>,
+    Field<UpdateReq, fields::PRICE, double, &UpdateReq::price>,
+    Field<UpdateReq, fields::SIZE, double, &UpdateReq::size>>;
+
+// Serialize function for UpdateReq
+inline void serialize_update_req(Buffer& buf, const UpdateReq& req) {
+  JsonSerializer<Buffer> serializer(buf);
+  UpdateReqSchema::serialize(req, serializer);
+}
+
+}  // namespace v1
@@ -1,489 +1,36 @@
 #include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <array>
-#include <charconv>
-#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <memory>
 #include <random>
 #include <string>
 #include <string_view>
-#include <tuple>
-#include <utility>
+#include <thread>
 #include <vector>
 
-#if defined(__GNUC__) || defined(__clang__)
-#define LIKELY(x) __builtin_expect(!!(x), 1)
-#define UNLIKELY(x) __builtin_expect(!!(x), 0)
-#else
-#define LIKELY(x) (x)
-#define UNLIKELY(x) (x)
-#endif
-
-#if defined(__GNUC__) || defined(__clang__)
-#define FORCE_INLINE inline __attribute__((always_inline))
-#elif defined(_MSC_VER)
-#define FORCE_INLINE __forceinline
-#else
-#define FORCE_INLINE inline
-#endif
-
-#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
-#define ALIGNED(x) alignas(x)
-#else
-#define ALIGNED(x)
-#endif
-
-class ALIGNED(64) Buffer {
- public:
-  explicit Buffer(size_t capacity)
-      : data_(std::make_unique<char[]>(capacity)),
-        capacity_(capacity),
-        size_(0) {}
-
-  Buffer(const Buffer&) = delete;
-  Buffer& operator=(const Buffer&) = delete;
-  Buffer(Buffer&&) noexcept = default;
-  Buffer& operator=(Buffer&&) noexcept = default;
-
-  FORCE_INLINE void reserve(size_t new_capacity) {
-    if (LIKELY(new_capacity <= capacity_)) {
-      return;
-    }
-
-    auto new_data = std::make_unique<char[]>(new_capacity);
-    std::memcpy(new_data.get(), data_.get(), size_);
-    data_ = std::move(new_data);
-    capacity_ = new_capacity;
-  }
-
-  FORCE_INLINE void append(const char* str, size_t len) {
-    if (UNLIKELY(size_ + len > capacity_)) {
-      reserve((size_ + len) * 2);
-    }
-    std::memcpy(data_.get() + size_, str, len);
-    size_ += len;
-  }
-
-  FORCE_INLINE void append(char c) {
-    if (UNLIKELY(size_ + 1 > capacity_)) {
-      reserve(capacity_ * 2);
-    }
-    data_[size_++] = c;
-  }
-
-  FORCE_INLINE void append(const char* str) { append(str, strlen(str)); }
-
-  FORCE_INLINE void append(std::string_view sv) {
-    append(sv.data(), sv.size());
-  }
-
-  FORCE_INLINE void reset() { size_ = 0; }
-
-  [[nodiscard]] FORCE_INLINE char* current() const {
-    return data_.get() + size_;
-  }
-
-  [[nodiscard]] FORCE_INLINE size_t remaining() const {
-    return capacity_ - size_;
-  }
-
-  [[nodiscard]] FORCE_INLINE const char* data() const { return data_.get(); }
-
-  [[nodiscard]] FORCE_INLINE size_t size() const { return size_; }
-
-  [[nodiscard]] FORCE_INLINE std::string_view view() const {
-    return std::string_view(data_.get(), size_);
-  }
-
-  [[nodiscard]] FORCE_INLINE size_t capacity() const { return capacity_; }
-
-  [[nodiscard]] FORCE_INLINE size_t& size() { return size_; }
-
- private:
-  std::unique_ptr<char[]> data_;
-  size_t capacity_;
-  size_t size_;
-};
+#include "common/alloc_counter.h"
+#include "common/latency_recorder.h"
+#include "common/perf_counters.h"
+#include "common/results.h"
+#include "v3.h"
 
-template <typename BufferType>
-class DeribitJsonRpc {
- public:
-  static constexpr const char JSON_COMMA = ',';
-  static constexpr const char JSON_COLON = ':';
-  static constexpr const char JSON_QUOTE = '"';
-  static constexpr const char JSON_OPEN_BRACE = '{';
-  static constexpr const char JSON_CLOSE_BRACE = '}';
-  static constexpr const char JSON_OPEN_BRACKET = '[';
-  static constexpr const char JSON_CLOSE_BRACKET = ']';
-  static constexpr const char* JSON_TRUE = "true";
-  static constexpr const char* JSON_FALSE = "false";
-  static constexpr const char* JSON_NULL = "null";
-  static constexpr const char* JSON_RPC_VERSION = "\"jsonrpc\":\"2.0\"";
-  static constexpr const char* JSON_METHOD = "\"method\":";
-  static constexpr const char* JSON_ID = "\"id\":";
-  static constexpr const char* JSON_PARAMS = "\"params\":";
-  static constexpr size_t MAX_INT_CHARS = 32;
-
-  explicit DeribitJsonRpc(BufferType& buffer)
-      : buffer_(buffer), first_field_(true) {}
-
-  FORCE_INLINE void begin_object() {
-    buffer_.append(JSON_OPEN_BRACE);
-    first_field_ = true;
-  }
-
-  FORCE_INLINE void end_object() { buffer_.append(JSON_CLOSE_BRACE); }
-
-  FORCE_INLINE void begin_array() {
-    buffer_.append(JSON_OPEN_BRACKET);
-    first_field_ = true;
-  }
-
-  FORCE_INLINE void end_array() { buffer_.append(JSON_CLOSE_BRACKET); }
-
-  FORCE_INLINE void serialize(const char* key, std::string_view value) {
-    write_key(key);
-    append_escaped_string(value);
-  }
-
-  FORCE_INLINE void serialize(const char* key, const std::string& value) {
-    serialize(key, std::string_view(value));
-  }
-
-  FORCE_INLINE void serialize(const char* key, const char* value) {
-    write_key(key);
-    append_escaped_string(std::string_view(value));
-  }
-
-  FORCE_INLINE void append_escaped_string(std::string_view value) {
-    buffer_.append(JSON_QUOTE);
-    buffer_.append(value.data(), value.size());
-    buffer_.append(JSON_QUOTE);
-  }
-
-  FORCE_INLINE void serialize(const char* key, double value) {
-    write_key(key);
-    char buf[MAX_INT_CHARS];
-    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
-    if (LIKELY(ec == std::errc())) {
-      buffer_.append(buf, ptr - buf);
-    }
-  }
-
-  FORCE_INLINE void serialize(const char* key, int64_t value) {
-    write_key(key);
-    char buf[MAX_INT_CHARS];
-    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
-    if (LIKELY(ec == std::errc())) {
-      buffer_.append(buf, ptr - buf);
-    }
-  }
-
-  FORCE_INLINE void serialize(const char* key, int value) {
-    serialize(key, static_cast<int64_t>(value));
-  }
-
-  FORCE_INLINE void serialize(const char* key, bool value) {
-    write_key(key);
-    if (value) {
-      buffer_.append(JSON_TRUE, 4);
-    } else {
-      buffer_.append(JSON_FALSE, 5);
-    }
-  }
-
-  FORCE_INLINE void serialize_null(const char* key) {
-    write_key(key);
-    buffer_.append(JSON_NULL, 4);
-  }
-
-  FORCE_INLINE void begin_json_rpc(const char* method, int id) {
-    begin_object();
-    // Optimize common JSON-RPC fields by writing them directly
-    if (!first_field_) buffer_.append(JSON_COMMA);
-    first_field_ = false;
-    buffer_.append(JSON_RPC_VERSION);
-
-    buffer_.append(JSON_COMMA);
-    buffer_.append(JSON_METHOD);
-    buffer_.append(JSON_QUOTE);
-    buffer_.append(method);
-    buffer_.append(JSON_QUOTE);
-
-    buffer_.append(JSON_COMMA);
-    buffer_.append(JSON_ID);
-    char id_buf[16];
-    auto [ptr, ec] = std::to_chars(id_buf, id_buf + sizeof(id_buf), id);
-    if (LIKELY(ec == std::errc())) {
-      buffer_.append(id_buf, ptr - id_buf);
-    }
-
-    buffer_.append(JSON_COMMA);
-    buffer_.append(JSON_PARAMS);
-    begin_object();
-  }
-
-  FORCE_INLINE void end_json_rpc() {
-    end_object();  // end params
-    end_object();  // end rpc object
-  }
-
- private:
-  FORCE_INLINE void write_key(const char* key) {
-    if (!first_field_) {
-      buffer_.append(JSON_COMMA);
-    } else {
-      first_field_ = false;
-    }
-    buffer_.append(JSON_QUOTE);
-    buffer_.append(key);
-    buffer_.append(JSON_QUOTE);
-    buffer_.append(JSON_COLON);
-  }
-
-  BufferType& buffer_;
-  bool first_field_;
-};
-
-namespace deribit {
-namespace fields {
-static constexpr const char INSTRUMENT_NAME[] = "instrument_name";
-static constexpr const char AMOUNT[] = "amount";
-static constexpr const char PRICE[] = "price";
-static constexpr const char TYPE[] = "type";
-static constexpr const char LABEL[] = "label";
-static constexpr const char ORDER_ID[] = "order_id";
-static constexpr const char REDUCE_ONLY[] = "reduce_only";
-static constexpr const char POST_ONLY[] = "post_only";
-static constexpr const char TIME_IN_FORCE[] = "time_in_force";
-static constexpr const char MAX_SHOW[] = "max_show";
-}  // namespace fields
-
-namespace methods {
-static constexpr const char PRIVATE_BUY[] = "private/buy";
-static constexpr const char PRIVATE_SELL[] = "private/sell";
-static constexpr const char PRIVATE_EDIT[] = "private/edit";
-static constexpr const char PRIVATE_CANCEL[] = "private/cancel";
-static constexpr const char PRIVATE_GET_POSITIONS[] = "private/get_positions";
-}  // namespace methods
-
-namespace order_types {
-static constexpr const char LIMIT[] = "limit";
-static constexpr const char MARKET[] = "market";
-static constexpr const char STOP_LIMIT[] = "stop_limit";
-static constexpr const char STOP_MARKET[] = "stop_market";
-}  // namespace order_types
-
-namespace time_in_force {
-static constexpr const char GTC[] = "good_til_cancelled";
-static constexpr const char IOC[] = "immediate_or_cancel";
-static constexpr const char FOK[] = "fill_or_kill";
-}  // namespace time_in_force
-}  // namespace deribit
-
-struct ALIGNED(32) DeribitOrderRequest {
-  std::string instrument_name;
-  double amount;
-  double price;
-  std::string type;
-  std::string label;
-  bool reduce_only;
-  bool post_only;
-  std::string time_in_force;
-  double max_show;
-};
-
-struct ALIGNED(32) DeribitEditRequest {
-  std::string order_id;
-  double amount;
-  double price;
-  bool post_only;
-  double max_show;
-};
-
-struct ALIGNED(32) DeribitCancelRequest {
-  std::string order_id;
-};
-
-// Schema pattern for field serialization
-template <typename T, const char* Name, typename Type, Type T::* Member>
-struct Field {
-  static constexpr const char* name = Name;
-
-  template <typename U>
-  [[nodiscard]] static FORCE_INLINE auto get(const U& obj)
-      -> decltype(static_cast<const T&>(obj).*Member) {
-    return static_cast<const T&>(obj).*Member;
-  }
-};
-
-// Schema pattern
-template <typename... Fields>
-struct Schema {
-  template <typename T, typename BufferType>
-  static FORCE_INLINE void serialize(const T& obj,
-                                     DeribitJsonRpc<BufferType>& serializer) {
-    serialize_fields<0>(obj, serializer);
-  }
-
-  template <size_t I, typename T, typename BufferType>
-  static FORCE_INLINE void serialize_fields(
-      const T& obj, DeribitJsonRpc<BufferType>& serializer) {
-    if constexpr (I < sizeof...(Fields)) {
-      using FieldType =
-          typename std::tuple_element<I, std::tuple<Fields...>>::type;
-      serializer.serialize(FieldType::name, FieldType::get(obj));
-      serialize_fields<I + 1>(obj, serializer);
-    }
-  }
-};
-
-// Schema for Deribit requests
-using BuySellSchema =
-    Schema<Field<DeribitOrderRequest, deribit::fields::INSTRUMENT_NAME,
-                 std::string, &DeribitOrderRequest::instrument_name>,
-           Field<DeribitOrderRequest, deribit::fields::AMOUNT, double,
-                 &DeribitOrderRequest::amount>,
-           Field<DeribitOrderRequest, deribit::fields::PRICE, double,
-                 &DeribitOrderRequest::price>,
-           Field<DeribitOrderRequest, deribit::fields::TYPE, std::string,
-                 &DeribitOrderRequest::type>,
-           Field<DeribitOrderRequest, deribit::fields::LABEL, std::string,
-                 &DeribitOrderRequest::label>,
-           Field<DeribitOrderRequest, deribit::fields::REDUCE_ONLY, bool,
-                 &DeribitOrderRequest::reduce_only>,
-           Field<DeribitOrderRequest, deribit::fields::POST_ONLY, bool,
-                 &DeribitOrderRequest::post_only>,
-           Field<DeribitOrderRequest, deribit::fields::TIME_IN_FORCE,
-                 std::string, &DeribitOrderRequest::time_in_force>,
-           Field<DeribitOrderRequest, deribit::fields::MAX_SHOW, double,
-                 &DeribitOrderRequest::max_show>>;
-
-using EditSchema = Schema<Field<DeribitEditRequest, deribit::fields::ORDER_ID,
-                                std::string, &DeribitEditRequest::order_id>,
-                          Field<DeribitEditRequest, deribit::fields::AMOUNT,
-                                double, &DeribitEditRequest::amount>,
-                          Field<DeribitEditRequest, deribit::fields::PRICE,
-                                double, &DeribitEditRequest::price>,
-                          Field<DeribitEditRequest, deribit::fields::POST_ONLY,
-                                bool, &DeribitEditRequest::post_only>,
-                          Field<DeribitEditRequest, deribit::fields::MAX_SHOW,
-                                double, &DeribitEditRequest::max_show>>;
-
-using CancelSchema =
-    Schema<Field<DeribitCancelRequest, deribit::fields::ORDER_ID, std::string,
-                 &DeribitCancelRequest::order_id>>;
-
-// Deribit API client class
-class ALIGNED(64) DeribitClient {
- public:
-  DeribitClient() : buffer_(8192), request_id_(1) {}
-
-  // Prevent copies, allow moves
-  DeribitClient(const DeribitClient&) = delete;
-  DeribitClient& operator=(const DeribitClient&) = delete;
-  DeribitClient(DeribitClient&&) noexcept = default;
-  DeribitClient& operator=(DeribitClient&&) noexcept = default;
-
-  // Create buy order JSON-RPC
-  [[nodiscard]] FORCE_INLINE std::string_view create_buy_request(
-      const DeribitOrderRequest& req) {
-    buffer_.reset();
-    DeribitJsonRpc<Buffer> rpc(buffer_);
-
-    rpc.begin_json_rpc(deribit::methods::PRIVATE_BUY, request_id_++);
-    BuySellSchema::serialize(req, rpc);
-    rpc.end_json_rpc();
-
-    return buffer_.view();
-  }
-
-  // Create sell order JSON-RPC
-  [[nodiscard]] FORCE_INLINE std::string_view create_sell_request(
-      const DeribitOrderRequest& req) {
-    buffer_.reset();
-    DeribitJsonRpc<Buffer> rpc(buffer_);
-
-    rpc.begin_json_rpc(deribit::methods::PRIVATE_SELL, request_id_++);
-    BuySellSchema::serialize(req, rpc);
-    rpc.end_json_rpc();
-
-    return buffer_.view();
-  }
-
-  // Create edit order JSON-RPC
-  [[nodiscard]] FORCE_INLINE std::string_view create_edit_request(
-      const DeribitEditRequest& req) {
-    buffer_.reset();
-    DeribitJsonRpc<Buffer> rpc(buffer_);
-
-    rpc.begin_json_rpc(deribit::methods::PRIVATE_EDIT, request_id_++);
-    EditSchema::serialize(req, rpc);
-    rpc.end_json_rpc();
-
-    return buffer_.view();
-  }
-
-  // Create cancel order JSON-RPC
-  [[nodiscard]] FORCE_INLINE std::string_view create_cancel_request(
-      const DeribitCancelRequest& req) {
-    buffer_.reset();
-    DeribitJsonRpc<Buffer> rpc(buffer_);
-
-    rpc.begin_json_rpc(deribit::methods::PRIVATE_CANCEL, request_id_++);
-    CancelSchema::serialize(req, rpc);
-    rpc.end_json_rpc();
-
-    return buffer_.view();
-  }
-
-  // Create get positions JSON-RPC
-  [[nodiscard]] FORCE_INLINE std::string_view create_get_positions_request() {
-    buffer_.reset();
-    DeribitJsonRpc<Buffer> rpc(buffer_);
-
-    rpc.begin_json_rpc(deribit::methods::PRIVATE_GET_POSITIONS, request_id_++);
-    rpc.end_json_rpc();
-
-    return buffer_.view();
-  }
-
-  // Manual serialization function for comparison with schema-based approach
-  [[nodiscard]] FORCE_INLINE std::string_view create_buy_request_manual(
-      const DeribitOrderRequest& req) {
-    buffer_.reset();
-    DeribitJsonRpc<Buffer> rpc(buffer_);
-
-    rpc.begin_json_rpc(deribit::methods::PRIVATE_BUY, request_id_++);
-
-    // Manually serialize each field (no schema)
-    rpc.serialize(deribit::fields::INSTRUMENT_NAME, req.instrument_name);
-    rpc.serialize(deribit::fields::AMOUNT, req.amount);
-    rpc.serialize(deribit::fields::PRICE, req.price);
-    rpc.serialize(deribit::fields::TYPE, req.type);
-    rpc.serialize(deribit::fields::LABEL, req.label);
-    rpc.serialize(deribit::fields::REDUCE_ONLY, req.reduce_only);
-    rpc.serialize(deribit::fields::POST_ONLY, req.post_only);
-    rpc.serialize(deribit::fields::TIME_IN_FORCE, req.time_in_force);
-    rpc.serialize(deribit::fields::MAX_SHOW, req.max_show);
-
-    rpc.end_json_rpc();
-
-    return buffer_.view();
-  }
-
- private:
-  Buffer buffer_;
-  int request_id_;
-};
+using namespace v3;
 
+namespace v3 {
 // Example of explicit template instantiation to help compiler optimize
 template class DeribitJsonRpc<Buffer>;
 template void
 Schema<Field<DeribitOrderRequest, deribit::fields::INSTRUMENT_NAME, std::string,
              &DeribitOrderRequest::instrument_name>>::
     serialize(const DeribitOrderRequest&, DeribitJsonRpc<Buffer>&);
+}  // namespace v3
 
 // Create realistic test data for benchmarks
 struct TestData {
@@ -524,10 +71,66 @@ struct TestData {
     }
     return result;
   }
+
+  // Realistic edit mix: mostly price moves, some size changes and rare
+  // flag or display changes
+  static std::vector<TrackedOrder> createEditMix(size_t count) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> kind(0, 99);
+    std::vector<TrackedOrder> orders;
+    orders.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      TrackedOrder order(createEditRequest());
+      const int k = kind(rng);
+      order.set_price(40500.0 + (k % 20) * 0.5);
+      if (k >= 70) order.set_amount(150.0 + k);
+      if (k >= 90) order.set_max_show(150.0 + k);
+      if (k >= 97) order.set_post_only(false);
+      orders.push_back(std::move(order));
+    }
+    return orders;
+  }
+
+  // Option chain names such as BTC-27DEC24-50000-C
+  static std::vector<std::string> createOptionInstrumentNames(size_t count) {
+    static const char* expiries[] = {"27DEC24", "31JAN25", "28FEB25",
+                                     "28MAR25", "27JUN25", "26SEP25"};
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; names.size() < count; ++i) {
+      const char* expiry = expiries[i % 6];
+      const size_t strike = 20000 + (i / 12) * 500;
+      const char* side = (i / 6) % 2 == 0 ? "C" : "P";
+      names.push_back(std::string("BTC-") + expiry + "-" +
+                      std::to_string(strike) + "-" + side);
+    }
+    return names;
+  }
+
+  // Uniformly random instrument picks, fixed seed
+  static std::vector<uint32_t> createRandomPicks(size_t count, size_t range) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> dist(0, range - 1);
+    std::vector<uint32_t> picks(count);
+    for (auto& pick : picks) pick = dist(rng);
+    return picks;
+  }
+
+  // Distinct exchange order ids for batched benchmarks
+  static std::vector<std::string> createOrderIds(size_t count) {
+    std::vector<std::string> ids;
+    ids.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      ids.push_back("ETH-" + std::to_string(349223 + i));
+    }
+    return ids;
+  }
 };
 
 // Benchmark appending small strings to Buffer
 static void BM_BufferAppendSmallString(benchmark::State& state) {
+  PerfScope perf(state);
+  AllocScope allocs(state);
   for (auto _ : state) {
     Buffer buffer(1024);
     for (int i = 0; i < 100; ++i) {
@@ -544,11 +147,17 @@ static void BM_BufferAppendLargeString(benchmark::State& state) {
   // Size of string to append
   const size_t size = state.range(0);
 
+  PerfScope perf(state);
+  AllocScope allocs(state);
   for (auto _ : state) {
+    perf.pause();
+    allocs.pause();
     state.PauseTiming();
     std::string large_string(size, 'X');
     Buffer buffer(64);  // Start with small buffer to test resize
     state.ResumeTiming();
+    allocs.resume();
+    perf.resume();
 
     buffer.append(large_string.c_str(), large_string.size());
     benchmark::DoNotOptimize(buffer.data());
@@ -561,12 +170,18 @@ BENCHMARK(BM_BufferAppendLargeString)->RangeMultiplier(4)->Range(64, 16384);
 static void BM_SerializeString(benchmark::State& state) {
   const size_t str_len = state.range(0);
 
+  PerfScope perf(state);
+  AllocScope allocs(state);
   for (auto _ : state) {
+    perf.pause();
+    allocs.pause();
     state.PauseTiming();
     std::string test_string = TestData::createRandomInstrumentName(str_len);
     Buffer buffer(1024);
     DeribitJsonRpc<Buffer> rpc(buffer);
     state.ResumeTiming();
+    allocs.resume();
+    perf.resume();
 
     rpc.begin_object();
     rpc.serialize("test_key", test_string);
@@ -582,6 +197,8 @@ BENCHMARK(BM_SerializeString)->RangeMultiplier(2)->Range(8, 1024);
 static void BM_SerializeNumeric(benchmark::State& state) {
   const double value = state.range(0) * 1.0;
 
+  PerfScope perf(state);
+  AllocScope allocs(state);
   for (auto _ : state) {
     Buffer buffer(1024);
     DeribitJsonRpc<Buffer> rpc(buffer);
@@ -602,6 +219,8 @@ static void BM_SchemaBasedSerialization(benchmark::State& state) {
   DeribitOrderRequest req = TestData::createOrderRequest();
   DeribitClient client;
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     auto result = client.create_buy_request(req);
     benchmark::DoNotOptimize(result.data());
@@ -610,11 +229,58 @@ static void BM_SchemaBasedSerialization(benchmark::State& state) {
 }
 BENCHMARK(BM_SchemaBasedSerialization);
 
+// Same as BM_SchemaBasedSerialization with runtime statistics on
+static void BM_SchemaBasedSerializationStats(benchmark::State& state) {
+  DeribitOrderRequest req = TestData::createOrderRequest();
+  DeribitClient client;
+  client.set_stats(&runtime_stats::register_thread("main"));
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    auto result = client.create_buy_request(req);
+    benchmark::DoNotOptimize(result.data());
+  }
+}
+BENCHMARK(BM_SchemaBasedSerializationStats);
+
+// An unattached USDT probe against the same loop without one; they should
+// match. Compare BM_SchemaBasedSerialization across a -DDISABLE_USDT build
+// for the whole message. With probes compiled in, the instruction counter
+// shows the probe's nop.
+static void BM_UsdtBaseline(benchmark::State& state) {
+  int64_t i = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(++i);
+  }
+}
+BENCHMARK(BM_UsdtBaseline);
+
+static void BM_UsdtProbe(benchmark::State& state) {
+  int64_t i = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(++i);
+    SERIALIZER_PROBE2(message_start, 0, i);
+  }
+  allocs.stop();
+  perf.stop();
+  state.SetLabel(SERIALIZER_USDT ? "probes compiled in" : "probes compiled out");
+}
+BENCHMARK(BM_UsdtProbe);
+
 // Benchmark manual serialization
 static void BM_ManualSerialization(benchmark::State& state) {
   DeribitOrderRequest req = TestData::createOrderRequest();
   DeribitClient client;
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     auto result = client.create_buy_request_manual(req);
     benchmark::DoNotOptimize(result.data());
@@ -640,6 +306,8 @@ class DeribitBenchmark : public benchmark::Fixture {
 
 // Benchmark buy request
 BENCHMARK_F(DeribitBenchmark, BM_BuyRequest)(benchmark::State& state) {
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     auto result = client.create_buy_request(buy_req);
     benchmark::DoNotOptimize(result.data());
@@ -649,6 +317,8 @@ BENCHMARK_F(DeribitBenchmark, BM_BuyRequest)(benchmark::State& state) {
 
 // Benchmark sell request
 BENCHMARK_F(DeribitBenchmark, BM_SellRequest)(benchmark::State& state) {
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     auto result = client.create_sell_request(buy_req);
     benchmark::DoNotOptimize(result.data());
@@ -658,6 +328,8 @@ BENCHMARK_F(DeribitBenchmark, BM_SellRequest)(benchmark::State& state) {
 
 // Benchmark edit request
 BENCHMARK_F(DeribitBenchmark, BM_EditRequest)(benchmark::State& state) {
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     auto result = client.create_edit_request(edit_req);
     benchmark::DoNotOptimize(result.data());
@@ -667,6 +339,8 @@ BENCHMARK_F(DeribitBenchmark, BM_EditRequest)(benchmark::State& state) {
 
 // Benchmark cancel request
 BENCHMARK_F(DeribitBenchmark, BM_CancelRequest)(benchmark::State& state) {
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     auto result = client.create_cancel_request(cancel_req);
     benchmark::DoNotOptimize(result.data());
@@ -676,6 +350,8 @@ BENCHMARK_F(DeribitBenchmark, BM_CancelRequest)(benchmark::State& state) {
 
 // Benchmark get positions request
 BENCHMARK_F(DeribitBenchmark, BM_GetPositionsRequest)(benchmark::State& state) {
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     auto result = client.create_get_positions_request();
     benchmark::DoNotOptimize(result.data());
@@ -686,44 +362,845 @@ BENCHMARK_F(DeribitBenchmark, BM_GetPositionsRequest)(benchmark::State& state) {
 // Measure latency distribution for order creation
 static void BM_OrderLatencyPercentiles(benchmark::State& state) {
   const int iterations = 10000;
-  std::vector<int64_t> latencies;
-  latencies.reserve(iterations);
+  LatencyRecorder recorder;
 
   DeribitOrderRequest req = TestData::createOrderRequest();
   DeribitClient client;
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
-    state.PauseTiming();
-    latencies.clear();
-    state.ResumeTiming();
-
     for (int i = 0; i < iterations; ++i) {
-      auto start = std::chrono::high_resolution_clock::now();
+      const uint64_t start = recorder.start();
 
       auto result = client.create_buy_request(req);
       benchmark::DoNotOptimize(result.data());
 
-      auto end = std::chrono::high_resolution_clock::now();
-      auto duration =
-          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
-              .count();
-      latencies.push_back(duration);
+      recorder.stop(start);
     }
+  }
+  allocs.stop();
+  perf.stop();
 
-    // Sort to calculate percentiles
-    std::sort(latencies.begin(), latencies.end());
+  recorder.report_to(state);
+}
+BENCHMARK(BM_OrderLatencyPercentiles)->Iterations(3);
 
-    // Report percentiles
-    state.counters["p50_ns"] = latencies[static_cast<size_t>(iterations * 0.5)];
-    state.counters["p90_ns"] = latencies[static_cast<size_t>(iterations * 0.9)];
-    state.counters["p99_ns"] =
-        latencies[static_cast<size_t>(iterations * 0.99)];
-    state.counters["p999_ns"] =
-        latencies[static_cast<size_t>(iterations * 0.999)];
-    state.counters["max_ns"] = latencies.back();
+// Requote N instruments with one create_edit_request + write per order
+static void BM_RequoteLoop(benchmark::State& state) {
+  const size_t count = state.range(0);
+  std::vector<std::string> ids = TestData::createOrderIds(count);
+  std::vector<DeribitEditRequest> edits(count, TestData::createEditRequest());
+  for (size_t i = 0; i < count; ++i) {
+    edits[i].order_id = ids[i];
   }
+
+  DeribitClient client;
+  FdTransport transport(::open("/dev/null", O_WRONLY));
+  double tick = 0.0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    tick += 0.5;
+    for (auto& edit : edits) {
+      edit.price = 40500.0 + tick;
+      auto result = client.create_edit_request(edit);
+      benchmark::DoNotOptimize(transport.send(result));
+    }
+  }
+  allocs.stop();
+  perf.stop();
+
+  ::close(transport.fd());
+  state.SetItemsProcessed(state.iterations() * count);
 }
-BENCHMARK(BM_OrderLatencyPercentiles)->Iterations(3);
+BENCHMARK(BM_RequoteLoop)->RangeMultiplier(10)->Range(10, 1000);
+
+// Requote N instruments as one batch handed to a single gather write
+static void BM_BulkRequote(benchmark::State& state) {
+  const size_t count = state.range(0);
+  std::vector<std::string> ids = TestData::createOrderIds(count);
+  std::vector<RequoteEntry> entries(count);
+  for (size_t i = 0; i < count; ++i) {
+    entries[i] = RequoteEntry{ids[i], 40500.0, 150.0, 150.0};
+  }
+
+  DeribitClient client;
+  BulkRequoter requoter;
+  FdTransport transport(::open("/dev/null", O_WRONLY));
+  double tick = 0.0;
+  // Size the frame tables before measuring
+  transport.send(requoter.requote(
+      entries, client.reserve_request_ids(static_cast<int>(count))));
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    tick += 0.5;
+    for (auto& entry : entries) {
+      entry.price = 40500.0 + tick;
+    }
+    auto frames = requoter.requote(
+        entries, client.reserve_request_ids(static_cast<int>(count)));
+    benchmark::DoNotOptimize(transport.send(frames));
+  }
+  allocs.stop();
+  perf.stop();
+
+  ::close(transport.fd());
+  state.SetItemsProcessed(state.iterations() * count);
+  state.counters["bytes_per_batch"] = requoter.view().size();
+}
+BENCHMARK(BM_BulkRequote)->RangeMultiplier(10)->Range(10, 1000);
+
+// Synthetic fast-market replay: every event reprices one of N resting orders
+// while the exchange only takes one edit every kDrainEvery events.
+static constexpr int kReplayEvents = 4096;
+static constexpr int kDrainEvery = 4;
+
+struct FastMarketReplay {
+  explicit FastMarketReplay(size_t orders)
+      : ids(TestData::createOrderIds(orders)) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> pick(0, orders - 1);
+    std::uniform_int_distribution<int> step(-2, 2);
+    std::vector<double> prices(orders, 40500.0);
+    for (int i = 0; i < kReplayEvents; ++i) {
+      size_t order = pick(rng);
+      prices[order] += step(rng) * 0.5;
+      DeribitEditRequest edit = TestData::createEditRequest();
+      edit.order_id = ids[order];
+      edit.price = prices[order];
+      events.push_back(std::move(edit));
+    }
+  }
+
+  std::vector<std::string> ids;
+  std::vector<DeribitEditRequest> events;
+};
+
+static int64_t tsc_now_ns() {
+  return static_cast<int64_t>(TscClock::now_ns());
+}
+
+static void report_replay(benchmark::State& state,
+                          const LatencyRecorder& latencies, uint64_t bytes,
+                          uint64_t frames) {
+  const double runs = static_cast<double>(state.iterations());
+  state.counters["wire_bytes"] = bytes / runs;
+  state.counters["frames"] = frames / runs;
+  latencies.report_to(state);
+}
+
+// Baseline: every edit is serialized and queued as its own frame
+static void BM_FastMarketEditQueue(benchmark::State& state) {
+  FastMarketReplay replay(state.range(0));
+  DeribitClient client;
+  FdTransport transport(::open("/dev/null", O_WRONLY));
+
+  std::vector<std::string> queue(kReplayEvents);
+  std::vector<int64_t> submitted(kReplayEvents);
+  for (auto& frame : queue) frame.reserve(256);
+  LatencyRecorder latencies;
+  uint64_t bytes = 0;
+  uint64_t frames = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    size_t head = 0;
+    size_t tail = 0;
+    auto send_one = [&]() {
+      transport.send(queue[head]);
+      latencies.record_ns(tsc_now_ns() - submitted[head]);
+      bytes += queue[head].size();
+      ++frames;
+      ++head;
+    };
+
+    for (int i = 0; i < kReplayEvents; ++i) {
+      queue[tail].assign(client.create_edit_request(replay.events[i]));
+      submitted[tail++] = tsc_now_ns();
+      if (i % kDrainEvery == kDrainEvery - 1) send_one();
+    }
+    while (head != tail) send_one();
+  }
+  allocs.stop();
+  perf.stop();
+
+  ::close(transport.fd());
+  report_replay(state, latencies, bytes, frames);
+}
+BENCHMARK(BM_FastMarketEditQueue)->Arg(8)->Arg(64)->Arg(512);
+
+// Coalesced: pending edits for the same order are patched in place
+static void BM_FastMarketEditCoalesced(benchmark::State& state) {
+  FastMarketReplay replay(state.range(0));
+  DeribitClient client;
+  EditCoalescer coalescer(kReplayEvents);
+  FdTransport transport(::open("/dev/null", O_WRONLY));
+  LatencyRecorder latencies;
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    for (int i = 0; i < kReplayEvents; ++i) {
+      coalescer.submit(replay.events[i], client.reserve_request_ids(1),
+                       tsc_now_ns());
+      if (i % kDrainEvery == kDrainEvery - 1 &&
+          UNLIKELY(coalescer.drain(transport, 1, tsc_now_ns(), &latencies) <
+                   0)) {
+        state.SkipWithError("coalesced edit write failed");
+        break;
+      }
+    }
+    if (UNLIKELY(coalescer.drain(transport, kReplayEvents, tsc_now_ns(),
+                                 &latencies) < 0)) {
+      state.SkipWithError("coalesced edit write failed");
+      break;
+    }
+  }
+  allocs.stop();
+  perf.stop();
+
+  ::close(transport.fd());
+  report_replay(state, latencies, coalescer.sent_bytes(),
+                coalescer.sent_frames());
+}
+BENCHMARK(BM_FastMarketEditCoalesced)->Arg(8)->Arg(64)->Arg(512);
+
+// Local peer draining everything written to the other end of a socketpair
+class MockPeer {
+ public:
+  MockPeer() : bytes_(0) {
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_);
+    reader_ = std::thread([this]() {
+      char buf[65536];
+      ssize_t n;
+      while ((n = ::read(fds_[1], buf, sizeof(buf))) > 0) {
+        bytes_.fetch_add(n, std::memory_order_relaxed);
+      }
+    });
+  }
+
+  ~MockPeer() {
+    ::shutdown(fds_[0], SHUT_WR);
+    reader_.join();
+    ::close(fds_[0]);
+    ::close(fds_[1]);
+  }
+
+  [[nodiscard]] int fd() const { return fds_[0]; }
+  [[nodiscard]] uint64_t bytes() const { return bytes_.load(); }
+
+ private:
+  int fds_[2];
+  std::atomic<uint64_t> bytes_;
+  std::thread reader_;
+};
+
+// Burst of places with edits and cancels mixed in, sent through the
+// scheduler under a credit budget to a local mock peer
+static void run_burst(benchmark::State& state, bool strict_priority) {
+  DeribitClient client;
+  DeribitOrderRequest place = TestData::createOrderRequest();
+  DeribitEditRequest edit = TestData::createEditRequest();
+  DeribitCancelRequest cancel = TestData::createCancelRequest();
+
+  const int burst = state.range(0);
+  std::vector<std::pair<Lane, std::string>> frames;
+  for (int i = 0; i < burst; ++i) {
+    if (i % 10 == 9) {
+      frames.emplace_back(Lane::Cancel, client.create_cancel_request(cancel));
+    } else if (i % 3 == 0) {
+      frames.emplace_back(Lane::Edit, client.create_edit_request(edit));
+    } else {
+      frames.emplace_back(Lane::Place, client.create_buy_request(place));
+    }
+  }
+
+  // 20 request burst allowance, 20k requests per second sustained
+  CreditConfig credits{.max_credits = 20000.0,
+                       .refill_per_sec = 2e7,
+                       .cost = {1000.0, 1000.0, 1000.0}};
+  MockPeer peer;
+  FdTransport transport(peer.fd());
+  SendScheduler scheduler(credits, 16, strict_priority);
+  std::array<LatencyRecorder, LANE_COUNT> delays;
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    for (const auto& [lane, frame] : frames) {
+      if (UNLIKELY(!scheduler.submit(lane, frame, tsc_now_ns()))) {
+        state.SkipWithError("frame rejected by the send scheduler");
+        break;
+      }
+    }
+    while (scheduler.queued() > 0) {
+      if (UNLIKELY(scheduler.poll(transport, tsc_now_ns(),
+                                  {&delays[0], &delays[1], &delays[2]}) <
+                   0)) {
+        state.SkipWithError("scheduled write failed");
+        break;
+      }
+    }
+  }
+  allocs.stop();
+  perf.stop();
+
+  static const char* names[] = {"cancel", "edit", "place"};
+  for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+    delays[lane].report_to(state, std::string(names[lane]) + "_");
+  }
+}
+
+static void BM_BurstSingleQueue(benchmark::State& state) {
+  run_burst(state, false);
+}
+BENCHMARK(BM_BurstSingleQueue)->Arg(400)->Unit(benchmark::kMillisecond);
+
+static void BM_BurstPriorityLanes(benchmark::State& state) {
+  run_burst(state, true);
+}
+BENCHMARK(BM_BurstPriorityLanes)->Arg(400)->Unit(benchmark::kMillisecond);
+
+// Splits a byte stream into top-level JSON objects
+class JsonFrameSplitter {
+ public:
+  template <typename OnFrame>
+  void feed(const char* data, size_t len, OnFrame&& on_frame) {
+    for (size_t i = 0; i < len; ++i) {
+      const char c = data[i];
+      pending_.push_back(c);
+      if (in_string_) {
+        if (escaped_) {
+          escaped_ = false;
+        } else if (c == '\\') {
+          escaped_ = true;
+        } else if (c == '"') {
+          in_string_ = false;
+        }
+      } else if (c == '"') {
+        in_string_ = true;
+      } else if (c == '{') {
+        ++depth_;
+      } else if (c == '}' && --depth_ == 0) {
+        on_frame(std::string_view(pending_));
+        pending_.clear();
+      }
+    }
+  }
+
+ private:
+  std::string pending_;
+  int depth_ = 0;
+  bool in_string_ = false;
+  bool escaped_ = false;
+};
+
+// Local exchange stand-in answering every request with a result carrying
+// the same id
+class MockExchange {
+ public:
+  MockExchange() {
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_);
+    server_ = std::thread([this]() { serve(); });
+  }
+
+  ~MockExchange() {
+    ::shutdown(fds_[0], SHUT_WR);
+    server_.join();
+    ::close(fds_[0]);
+    ::close(fds_[1]);
+  }
+
+  [[nodiscard]] int fd() const { return fds_[0]; }
+
+  // Block until count responses arrived on the client end
+  void await_responses(size_t count) {
+    char buf[65536];
+    size_t seen = 0;
+    while (seen < count) {
+      ssize_t n = ::read(fds_[0], buf, sizeof(buf));
+      if (n <= 0) return;
+      responses_.feed(buf, n, [&](std::string_view) {
+        TRACE_INSTANT(ResponseParsed, seen);
+        ++seen;
+      });
+    }
+  }
+
+ private:
+  void serve() {
+    JsonFrameSplitter requests;
+    char buf[65536];
+    std::string reply;
+    ssize_t n;
+    while ((n = ::read(fds_[1], buf, sizeof(buf))) > 0) {
+      reply.clear();
+      requests.feed(buf, n, [&](std::string_view frame) {
+        size_t pos = frame.find("\"id\":");
+        std::string_view id = frame.substr(pos + 5);
+        id = id.substr(0, id.find_first_of(",}"));
+        reply.append("{\"jsonrpc\":\"2.0\",\"id\":");
+        reply.append(id);
+        reply.append(",\"result\":\"ok\"}");
+      });
+      FdTransport(fds_[1]).send(reply);
+    }
+  }
+
+  int fds_[2];
+  std::thread server_;
+  JsonFrameSplitter responses_;
+};
+
+static std::vector<std::string> createBookChannels(size_t count) {
+  std::vector<std::string> channels;
+  for (const auto& name : TestData::createOptionInstrumentNames(count)) {
+    channels.push_back("book." + name + ".raw");
+  }
+  return channels;
+}
+
+// Reconnect by building and awaiting every setup request one at a time,
+// all channels in one batched subscribe
+static void BM_ReconnectSequential(benchmark::State& state) {
+  std::vector<std::string> channels = createBookChannels(state.range(0));
+  AuthCredentials credentials{"client_id_1234", "client_secret_abcdefgh"};
+  DeribitClient client;
+  MockExchange exchange;
+  FdTransport transport(exchange.fd());
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    transport.send(client.create_auth_request(credentials));
+    exchange.await_responses(1);
+    transport.send(client.create_set_heartbeat_request(30));
+    exchange.await_responses(1);
+    transport.send(client.create_enable_cancel_on_disconnect_request());
+    exchange.await_responses(1);
+    transport.send(client.create_subscribe_request(channels));
+    exchange.await_responses(1);
+  }
+  allocs.stop();
+  perf.stop();
+}
+BENCHMARK(BM_ReconnectSequential)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Reconnect by sending the pre-rendered bundle as one pipelined burst
+static void BM_ReconnectBundle(benchmark::State& state) {
+  SessionSetupBundle bundle(
+      AuthCredentials{"client_id_1234", "client_secret_abcdefgh"});
+  for (const auto& channel : createBookChannels(state.range(0))) {
+    bundle.add_subscription(channel);
+  }
+  bundle.refresh();
+  MockExchange exchange;
+  FdTransport transport(exchange.fd());
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    transport.send(bundle.iovecs());
+    exchange.await_responses(bundle.frame_count());
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.counters["bundle_bytes"] = [&]() {
+    size_t bytes = 0;
+    for (const iovec& part : bundle.iovecs()) bytes += part.iov_len;
+    return static_cast<double>(bytes);
+  }();
+}
+BENCHMARK(BM_ReconnectBundle)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Unit(benchmark::kMicrosecond);
+
+static constexpr size_t kSubscribeFrameSize = 32 * 1024;
+
+// Subscriptions for N instruments by concatenating channel strings and
+// serializing fixed-size chunks of them
+static void BM_SubscribeChannelStrings(benchmark::State& state) {
+  std::vector<std::string> names =
+      TestData::createOptionInstrumentNames(state.range(0));
+  DeribitClient client;
+  std::vector<std::string> channels;
+  size_t frames = 0;
+  // Chunk size that keeps every frame under the limit: the longest channel
+  // is "trades.<name>.100ms", each name adds its quotes and a comma, and
+  // the request around the list takes well under 128 bytes
+  size_t longest = 0;
+  for (const auto& name : names) longest = std::max(longest, name.size());
+  longest += std::char_traits<char>::length("trades..100ms");
+  const size_t chunk = (kSubscribeFrameSize - 128) / (longest + 3);
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    channels.clear();
+    for (const auto& name : names) {
+      channels.push_back("book." + name + ".raw");
+      channels.push_back("trades." + name + ".100ms");
+    }
+    frames = 0;
+    for (size_t i = 0; i < channels.size(); i += chunk) {
+      const size_t n = std::min(chunk, channels.size() - i);
+      auto result = client.create_subscribe_request(
+          std::span<const std::string>(channels.data() + i, n));
+      benchmark::DoNotOptimize(result.data());
+      ++frames;
+    }
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.counters["frames"] = frames;
+  state.SetItemsProcessed(state.iterations() * names.size() * 2);
+}
+BENCHMARK(BM_SubscribeChannelStrings)
+    ->Arg(500)
+    ->Arg(5000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Same subscriptions composed from templates and interned names, split by
+// size
+static void BM_SubscribeChannelBuilder(benchmark::State& state) {
+  std::vector<std::string> names =
+      TestData::createOptionInstrumentNames(state.range(0));
+  InstrumentRegistry instruments;
+  std::vector<InstrumentId> ids;
+  for (const auto& name : names) {
+    ids.push_back(instruments.intern(name));
+  }
+  const ChannelTemplate templates[] = {deribit::channels::BOOK_RAW,
+                                       deribit::channels::TRADES_100MS};
+  ChannelListBuilder builder(&instruments, kSubscribeFrameSize);
+  DeribitClient client;
+  // Size the frame tables before measuring
+  builder.begin(0);
+  builder.add(templates, ids);
+  builder.finish();
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    // Each frame claims its id from the client as it is opened
+    builder.begin(client);
+    builder.add(templates, ids);
+    auto frames = builder.finish();
+    benchmark::DoNotOptimize(frames.data());
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.counters["frames"] = builder.frame_count();
+  state.SetItemsProcessed(state.iterations() * names.size() * 2);
+}
+BENCHMARK(BM_SubscribeChannelBuilder)
+    ->Arg(500)
+    ->Arg(5000)
+    ->Unit(benchmark::kMicrosecond);
+
+// Panic cancel of N live orders, building each cancel frame on demand
+static void BM_PanicCancelOnDemand(benchmark::State& state) {
+  const size_t count = state.range(0);
+  std::vector<std::string> ids = TestData::createOrderIds(count);
+  std::vector<DeribitCancelRequest> cancels(count);
+  for (size_t i = 0; i < count; ++i) {
+    cancels[i].order_id = ids[i];
+  }
+
+  DeribitClient client;
+  FdTransport transport(::open("/dev/null", O_WRONLY));
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    for (const auto& cancel : cancels) {
+      auto result = client.create_cancel_request(cancel);
+      benchmark::DoNotOptimize(transport.send(result));
+    }
+  }
+  allocs.stop();
+  perf.stop();
+
+  ::close(transport.fd());
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_PanicCancelOnDemand)->Arg(100)->Arg(1000);
+
+// Panic cancel of N live orders from pre-serialized frames
+static void BM_PanicCancelPreSerialized(benchmark::State& state) {
+  const size_t count = state.range(0);
+  std::vector<std::string> ids = TestData::createOrderIds(count);
+
+  DeribitClient client;
+  CancelRegistry registry(count);
+  for (const auto& id : ids) {
+    registry.on_order_acknowledged(id);
+  }
+  FdTransport transport(::open("/dev/null", O_WRONLY));
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    auto frames = registry.panic_cancel(
+        client.reserve_request_ids(static_cast<int>(count)));
+    benchmark::DoNotOptimize(transport.send(frames));
+  }
+  allocs.stop();
+  perf.stop();
+
+  ::close(transport.fd());
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_PanicCancelPreSerialized)->Arg(100)->Arg(1000);
+
+// Edits over a realistic mix, always sending every EditSchema field
+static void BM_EditMixFullFields(benchmark::State& state) {
+  std::vector<TrackedOrder> orders = TestData::createEditMix(1024);
+  DeribitClient client;
+  size_t i = 0;
+  size_t bytes = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    auto result = client.create_edit_request(orders[i++ & 1023].state());
+    bytes += result.size();
+    benchmark::DoNotOptimize(result.data());
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.counters["bytes_per_msg"] =
+      static_cast<double>(bytes) / state.iterations();
+}
+BENCHMARK(BM_EditMixFullFields);
+
+// Edits over the same mix, sending only dirty and required fields
+static void BM_EditMixDirtyFields(benchmark::State& state) {
+  std::vector<TrackedOrder> orders = TestData::createEditMix(1024);
+  DeribitClient client;
+  size_t i = 0;
+  size_t bytes = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    auto result = client.create_edit_request(orders[i++ & 1023]);
+    bytes += result.size();
+    benchmark::DoNotOptimize(result.data());
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.counters["bytes_per_msg"] =
+      static_cast<double>(bytes) / state.iterations();
+}
+BENCHMARK(BM_EditMixDirtyFields);
+
+// Place orders over an option chain, instrument names held as strings
+static void BM_PlaceOrderStringInstrument(benchmark::State& state) {
+  std::vector<std::string> names =
+      TestData::createOptionInstrumentNames(state.range(0));
+  std::vector<DeribitOrderRequest> orders(names.size(),
+                                          TestData::createOrderRequest());
+  for (size_t i = 0; i < names.size(); ++i) {
+    orders[i].instrument_name = names[i];
+  }
+  std::vector<uint32_t> picks = TestData::createRandomPicks(4096, names.size());
+  DeribitClient client;
+  size_t i = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    auto result = client.create_buy_request(orders[picks[i++ & 4095]]);
+    benchmark::DoNotOptimize(result.data());
+  }
+}
+BENCHMARK(BM_PlaceOrderStringInstrument)->Arg(1000)->Arg(8000)->Arg(32000);
+
+// Place orders over the same chain with interned instrument fragments
+static void BM_PlaceOrderInternedInstrument(benchmark::State& state) {
+  std::vector<std::string> names =
+      TestData::createOptionInstrumentNames(state.range(0));
+  InstrumentRegistry instruments;
+  DeribitOrderRequest base = TestData::createOrderRequest();
+  std::vector<DeribitInternedOrderRequest> orders;
+  orders.reserve(names.size());
+  for (const auto& name : names) {
+    orders.push_back(DeribitInternedOrderRequest{
+        .instrument = instruments.intern(name),
+        .amount = base.amount,
+        .price = base.price,
+        .type = base.type,
+        .label = base.label,
+        .reduce_only = base.reduce_only,
+        .post_only = base.post_only,
+        .time_in_force = base.time_in_force,
+        .max_show = base.max_show});
+  }
+  std::vector<uint32_t> picks = TestData::createRandomPicks(4096, names.size());
+  DeribitClient client;
+  size_t i = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    auto result =
+        client.create_buy_request(orders[picks[i++ & 4095]], instruments);
+    benchmark::DoNotOptimize(result.data());
+  }
+}
+BENCHMARK(BM_PlaceOrderInternedInstrument)->Arg(1000)->Arg(8000)->Arg(32000);
+
+// Orders around 40000 with about 1% priced outside a 5% band
+static std::vector<DeribitOrderRequest> createRiskMix(size_t count) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> move(-0.04, 0.04);
+  std::uniform_int_distribution<int> outlier(0, 99);
+  std::vector<DeribitOrderRequest> orders(count,
+                                          TestData::createOrderRequest());
+  for (auto& order : orders) {
+    const double offset = outlier(rng) == 0 ? 0.2 : move(rng);
+    order.price = std::round(40000.0 * (1.0 + offset) * 2.0) / 2.0;
+  }
+  return orders;
+}
+
+static const RiskLimits kRiskLimits{.min_amount = 1.0,
+                                    .max_amount = 10000.0,
+                                    .min_price = 1.0,
+                                    .max_price = 1e6,
+                                    .reference_price = 40000.0,
+                                    .max_deviation = 0.05,
+                                    .max_notional = 1e8};
+
+// Separate pass over the request before serializing it
+static FORCE_INLINE RiskVerdict check_order(const DeribitOrderRequest& req,
+                                            const RiskLimits& limits) {
+  if (req.amount < limits.min_amount || req.amount > limits.max_amount) {
+    return RiskVerdict::OutOfRange;
+  }
+  if (req.price < limits.min_price || req.price > limits.max_price) {
+    return RiskVerdict::OutOfRange;
+  }
+  if (limits.reference_price != 0.0 &&
+      std::abs(req.price - limits.reference_price) >
+          limits.reference_price * limits.max_deviation) {
+    return RiskVerdict::OutsideBand;
+  }
+  if (req.price * req.amount > limits.max_notional) {
+    return RiskVerdict::NotionalTooLarge;
+  }
+  return RiskVerdict::Ok;
+}
+
+static void BM_CheckThenSerialize(benchmark::State& state) {
+  std::vector<DeribitOrderRequest> orders = createRiskMix(1024);
+  DeribitClient client;
+  size_t i = 0;
+  size_t rejected = 0;
+
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    const DeribitOrderRequest& req = orders[i++ & 1023];
+    if (check_order(req, kRiskLimits) != RiskVerdict::Ok) {
+      ++rejected;
+      continue;
+    }
+    auto result = client.create_buy_request(req);
+    benchmark::DoNotOptimize(result.data());
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.counters["rejected"] = rejected;
+}
+BENCHMARK(BM_CheckThenSerialize);
+
+static void BM_FusedCheckSerialize(benchmark::State& state) {
+  std::vector<DeribitOrderRequest> orders = createRiskMix(1024);
+  DeribitClient client;
+  size_t i = 0;
+  size_t rejected = 0;
+  RiskVerdict verdict;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    auto result =
+        client.create_buy_request(orders[i++ & 1023], kRiskLimits, verdict);
+    rejected += verdict != RiskVerdict::Ok;
+    benchmark::DoNotOptimize(result.data());
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.counters["rejected"] = rejected;
+}
+BENCHMARK(BM_FusedCheckSerialize);
+
+#ifdef ENABLE_TRACING
+// Cost of one trace point on a registered thread
+static void BM_TracePoint(benchmark::State& state) {
+  trace::register_thread("main");
+  uint32_t i = 0;
+  for (auto _ : state) {
+    TRACE_INSTANT(StrategyDecision, i++);
+  }
+}
+BENCHMARK(BM_TracePoint);
+
+// The whole order path with every stage traced: decide, serialize, queue,
+// send, and wait for the response. Run it and convert the dump with
+// trace_to_chrome to see where each round trip goes.
+static void BM_TracedOrderPath(benchmark::State& state) {
+  trace::register_thread("main");
+  std::vector<DeribitOrderRequest> orders = createRiskMix(1024);
+  DeribitClient client;
+  CreditConfig unthrottled;
+  unthrottled.cost = {};
+  SendScheduler scheduler(unthrottled);
+  MockExchange exchange;
+  FdTransport transport(exchange.fd());
+  size_t i = 0;
+
+  for (auto _ : state) {
+    const DeribitOrderRequest* req;
+    {
+      TRACE_SCOPE(StrategyDecision, i);
+      req = &orders[i++ & 1023];
+    }
+    const int64_t now = tsc_now_ns();
+    if (UNLIKELY(!scheduler.submit(Lane::Place,
+                                   client.create_buy_request(*req), now))) {
+      state.SkipWithError("frame rejected by the send scheduler");
+      break;
+    }
+    if (UNLIKELY(scheduler.poll(transport, now) < 0)) {
+      state.SkipWithError("scheduled write failed");
+      break;
+    }
+    exchange.await_responses(1);
+  }
+}
+BENCHMARK(BM_TracedOrderPath)->Unit(benchmark::kMicrosecond);
+#endif
 
 // Main function for the benchmark mode
 int main(int argc, char** argv) {
@@ -740,13 +1217,84 @@ int main(int argc, char** argv) {
   // Print output
   std::cout << "Buy request: " << buy_json << std::endl;
 
+  // Bulk requote of two instruments
+  BulkRequoter requoter;
+  RequoteEntry entries[] = {{"ETH-349223", 40500.5, 150.0, 150.0},
+                            {"ETH-349224", 40499.5, 75.0, 75.0}};
+  requoter.requote(entries, client.reserve_request_ids(2));
+  for (size_t i = 0; i < requoter.frame_count(); ++i) {
+    std::cout << "Requote frame " << i << ": " << requoter.frame(i)
+              << std::endl;
+  }
+
+  // Buy request for an interned instrument
+  InstrumentRegistry instruments;
+  DeribitInternedOrderRequest interned_req{
+      .instrument = instruments.intern(buy_req.instrument_name),
+      .amount = buy_req.amount,
+      .price = buy_req.price,
+      .type = buy_req.type,
+      .label = buy_req.label,
+      .reduce_only = buy_req.reduce_only,
+      .post_only = buy_req.post_only,
+      .time_in_force = buy_req.time_in_force,
+      .max_show = buy_req.max_show};
+  std::cout << "Interned buy: "
+            << client.create_buy_request(interned_req, instruments)
+            << std::endl;
+
+  // Edit carrying only the changed price
+  TrackedOrder order(TestData::createEditRequest());
+  order.set_price(40600.0);
+  std::cout << "Dirty edit: " << client.create_edit_request(order)
+            << std::endl;
+
+  // Reconnect bundle with one subscription
+  SessionSetupBundle bundle(AuthCredentials{"client_id", "client_secret"});
+  bundle.add_subscription("book.BTC-PERPETUAL.raw");
+  bundle.refresh();
+  for (size_t i = 0; i < bundle.frame_count(); ++i) {
+    std::cout << "Setup frame " << i << ": " << bundle.frame(i) << std::endl;
+  }
+
+  // Subscription frames composed from channel templates
+  ChannelListBuilder channel_list(&instruments, 128);
+  const ChannelTemplate templates[] = {deribit::channels::BOOK_RAW,
+                                       deribit::channels::TRADES_100MS};
+  const InstrumentId ids[] = {instruments.intern("BTC-PERPETUAL"),
+                              instruments.intern("ETH-PERPETUAL")};
+  channel_list.begin(client);
+  channel_list.add(templates, ids);
+  channel_list.finish();
+  for (size_t i = 0; i < channel_list.frame_count(); ++i) {
+    std::cout << "Subscribe frame " << i << ": " << channel_list.frame(i)
+              << std::endl;
+  }
+
+  // Pre-serialized cancel for an acknowledged order
+  CancelRegistry registry;
+  registry.on_order_acknowledged("ETH-349223");
+  registry.panic_cancel(client.reserve_request_ids(1));
+  std::cout << "Cancel frame: " << registry.frame(0) << std::endl;
+
   return 0;
 #else
   // Run the benchmark
+  results::init("v3", argc, argv);
   ::benchmark::Initialize(&argc, argv);
   if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
   ::benchmark::RunSpecifiedBenchmarks();
   ::benchmark::Shutdown();
+  runtime_stats::snapshot().print();
+#ifdef ENABLE_TRACING
+  const char* trace_path = std::getenv("TRACE_FILE");
+  if (!trace_path) trace_path = "json_serializer_v3.trace";
+  if (!trace::dump(trace_path)) {
+    std::cerr << "cannot write " << trace_path << std::endl;
+    return 1;
+  }
+  std::cerr << "trace written to " << trace_path << std::endl;
+#endif
   return 0;
 #endif
 }
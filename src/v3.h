@@ -0,0 +1,2188 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/latency_recorder.h"
+#include "common/probes.h"
+#include "common/runtime_stats.h"
+#include "common/trace.h"
+
+#ifndef LIKELY
+#if defined(__GNUC__) || defined(__clang__)
+#define LIKELY(x) __builtin_expect(!!(x), 1)
+#define UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define LIKELY(x) (x)
+#define UNLIKELY(x) (x)
+#endif
+#endif
+
+#ifndef FORCE_INLINE
+#if defined(__GNUC__) || defined(__clang__)
+#define FORCE_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define FORCE_INLINE __forceinline
+#else
+#define FORCE_INLINE inline
+#endif
+#endif
+
+#ifndef ALIGNED
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define ALIGNED(x) alignas(x)
+#else
+#define ALIGNED(x)
+#endif
+#endif
+
+namespace v3 {
+
+class ALIGNED(64) Buffer {
+ public:
+  explicit Buffer(size_t capacity)
+      : data_(std::make_unique<char[]>(capacity)),
+        capacity_(capacity),
+        size_(0) {}
+
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+  Buffer(Buffer&&) noexcept = default;
+  Buffer& operator=(Buffer&&) noexcept = default;
+
+  FORCE_INLINE void reserve(size_t new_capacity) {
+    if (LIKELY(new_capacity <= capacity_)) {
+      return;
+    }
+
+    runtime_stats::buffer_grew();
+    SERIALIZER_PROBE2(buffer_grow, capacity_, new_capacity);
+    auto new_data = std::make_unique<char[]>(new_capacity);
+    std::memcpy(new_data.get(), data_.get(), size_);
+    data_ = std::move(new_data);
+    capacity_ = new_capacity;
+  }
+
+  FORCE_INLINE void append(const char* str, size_t len) {
+    if (UNLIKELY(size_ + len > capacity_)) {
+      reserve((size_ + len) * 2);
+    }
+    std::memcpy(data_.get() + size_, str, len);
+    size_ += len;
+  }
+
+  FORCE_INLINE void append(char c) {
+    if (UNLIKELY(size_ + 1 > capacity_)) {
+      reserve(capacity_ * 2);
+    }
+    data_[size_++] = c;
+  }
+
+  FORCE_INLINE void append(const char* str) { append(str, strlen(str)); }
+
+  FORCE_INLINE void append(std::string_view sv) {
+    append(sv.data(), sv.size());
+  }
+
+  FORCE_INLINE void reset() { size_ = 0; }
+
+  // Drop everything written after mark
+  FORCE_INLINE void rewind(size_t mark) { size_ = mark; }
+
+  [[nodiscard]] FORCE_INLINE char* current() const {
+    return data_.get() + size_;
+  }
+
+  [[nodiscard]] FORCE_INLINE size_t remaining() const {
+    return capacity_ - size_;
+  }
+
+  [[nodiscard]] FORCE_INLINE const char* data() const { return data_.get(); }
+
+  [[nodiscard]] FORCE_INLINE size_t size() const { return size_; }
+
+  [[nodiscard]] FORCE_INLINE std::string_view view() const {
+    return std::string_view(data_.get(), size_);
+  }
+
+  [[nodiscard]] FORCE_INLINE size_t capacity() const { return capacity_; }
+
+  [[nodiscard]] FORCE_INLINE size_t& size() { return size_; }
+
+ private:
+  std::unique_ptr<char[]> data_;
+  size_t capacity_;
+  size_t size_;
+};
+
+template <typename BufferType>
+class DeribitJsonRpc {
+ public:
+  static constexpr const char JSON_COMMA = ',';
+  static constexpr const char JSON_COLON = ':';
+  static constexpr const char JSON_QUOTE = '"';
+  static constexpr const char JSON_OPEN_BRACE = '{';
+  static constexpr const char JSON_CLOSE_BRACE = '}';
+  static constexpr const char JSON_OPEN_BRACKET = '[';
+  static constexpr const char JSON_CLOSE_BRACKET = ']';
+  static constexpr const char* JSON_TRUE = "true";
+  static constexpr const char* JSON_FALSE = "false";
+  static constexpr const char* JSON_NULL = "null";
+  static constexpr const char* JSON_RPC_VERSION = "\"jsonrpc\":\"2.0\"";
+  static constexpr const char* JSON_METHOD = "\"method\":";
+  static constexpr const char* JSON_ID = "\"id\":";
+  static constexpr const char* JSON_PARAMS = "\"params\":";
+  static constexpr size_t MAX_INT_CHARS = 32;
+
+  explicit DeribitJsonRpc(BufferType& buffer)
+      : buffer_(buffer), first_field_(true) {}
+
+  FORCE_INLINE void begin_object() {
+    buffer_.append(JSON_OPEN_BRACE);
+    first_field_ = true;
+  }
+
+  FORCE_INLINE void end_object() { buffer_.append(JSON_CLOSE_BRACE); }
+
+  FORCE_INLINE void begin_array() {
+    buffer_.append(JSON_OPEN_BRACKET);
+    first_field_ = true;
+  }
+
+  FORCE_INLINE void end_array() { buffer_.append(JSON_CLOSE_BRACKET); }
+
+  FORCE_INLINE void serialize(const char* key, std::string_view value) {
+    write_key(key);
+    append_escaped_string(value);
+  }
+
+  FORCE_INLINE void serialize(const char* key, const std::string& value) {
+    serialize(key, std::string_view(value));
+  }
+
+  FORCE_INLINE void serialize(const char* key, const char* value) {
+    write_key(key);
+    append_escaped_string(std::string_view(value));
+  }
+
+  FORCE_INLINE void append_escaped_string(std::string_view value) {
+    buffer_.append(JSON_QUOTE);
+    buffer_.append(value.data(), value.size());
+    buffer_.append(JSON_QUOTE);
+  }
+
+  FORCE_INLINE void serialize(const char* key, double value) {
+    write_key(key);
+    char buf[MAX_INT_CHARS];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    if (LIKELY(ec == std::errc())) {
+      buffer_.append(buf, ptr - buf);
+    } else {
+      SERIALIZER_PROBE1(number_fallback, key);
+    }
+  }
+
+  FORCE_INLINE void serialize(const char* key, int64_t value) {
+    write_key(key);
+    char buf[MAX_INT_CHARS];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    if (LIKELY(ec == std::errc())) {
+      buffer_.append(buf, ptr - buf);
+    } else {
+      SERIALIZER_PROBE1(number_fallback, key);
+    }
+  }
+
+  FORCE_INLINE void serialize(const char* key, int value) {
+    serialize(key, static_cast<int64_t>(value));
+  }
+
+  FORCE_INLINE void serialize(const char* key, bool value) {
+    write_key(key);
+    if (value) {
+      buffer_.append(JSON_TRUE, 4);
+    } else {
+      buffer_.append(JSON_FALSE, 5);
+    }
+  }
+
+  FORCE_INLINE void serialize_null(const char* key) {
+    write_key(key);
+    buffer_.append(JSON_NULL, 4);
+  }
+
+  // Serialize an array of strings
+  FORCE_INLINE void serialize(const char* key,
+                              std::span<const std::string> values) {
+    write_key(key);
+    buffer_.append(JSON_OPEN_BRACKET);
+    for (size_t i = 0; i < values.size(); ++i) {
+      if (i > 0) buffer_.append(JSON_COMMA);
+      append_escaped_string(values[i]);
+    }
+    buffer_.append(JSON_CLOSE_BRACKET);
+  }
+
+  // Append a pre-rendered "key":value fragment
+  FORCE_INLINE void serialize_fragment(std::string_view fragment) {
+    if (!first_field_) {
+      buffer_.append(JSON_COMMA);
+    } else {
+      first_field_ = false;
+    }
+    buffer_.append(fragment.data(), fragment.size());
+  }
+
+  FORCE_INLINE void begin_json_rpc(const char* method, int id) {
+    begin_object();
+    // Optimize common JSON-RPC fields by writing them directly
+    if (!first_field_) buffer_.append(JSON_COMMA);
+    first_field_ = false;
+    buffer_.append(JSON_RPC_VERSION);
+
+    buffer_.append(JSON_COMMA);
+    buffer_.append(JSON_METHOD);
+    buffer_.append(JSON_QUOTE);
+    buffer_.append(method);
+    buffer_.append(JSON_QUOTE);
+
+    buffer_.append(JSON_COMMA);
+    buffer_.append(JSON_ID);
+    char id_buf[16];
+    auto [ptr, ec] = std::to_chars(id_buf, id_buf + sizeof(id_buf), id);
+    if (LIKELY(ec == std::errc())) {
+      buffer_.append(id_buf, ptr - id_buf);
+    }
+
+    buffer_.append(JSON_COMMA);
+    buffer_.append(JSON_PARAMS);
+    begin_object();
+  }
+
+  FORCE_INLINE void end_json_rpc() {
+    end_object();  // end params
+    end_object();  // end rpc object
+  }
+
+ private:
+  FORCE_INLINE void write_key(const char* key) {
+    if (!first_field_) {
+      buffer_.append(JSON_COMMA);
+    } else {
+      first_field_ = false;
+    }
+    buffer_.append(JSON_QUOTE);
+    buffer_.append(key);
+    buffer_.append(JSON_QUOTE);
+    buffer_.append(JSON_COLON);
+  }
+
+  BufferType& buffer_;
+  bool first_field_;
+};
+
+namespace deribit {
+namespace fields {
+static constexpr const char INSTRUMENT_NAME[] = "instrument_name";
+static constexpr const char AMOUNT[] = "amount";
+static constexpr const char PRICE[] = "price";
+static constexpr const char TYPE[] = "type";
+static constexpr const char LABEL[] = "label";
+static constexpr const char ORDER_ID[] = "order_id";
+static constexpr const char REDUCE_ONLY[] = "reduce_only";
+static constexpr const char POST_ONLY[] = "post_only";
+static constexpr const char TIME_IN_FORCE[] = "time_in_force";
+static constexpr const char MAX_SHOW[] = "max_show";
+static constexpr const char GRANT_TYPE[] = "grant_type";
+static constexpr const char CLIENT_ID[] = "client_id";
+static constexpr const char CLIENT_SECRET[] = "client_secret";
+static constexpr const char INTERVAL[] = "interval";
+static constexpr const char SCOPE[] = "scope";
+static constexpr const char CHANNELS[] = "channels";
+}  // namespace fields
+
+namespace methods {
+static constexpr const char PRIVATE_BUY[] = "private/buy";
+static constexpr const char PRIVATE_SELL[] = "private/sell";
+static constexpr const char PRIVATE_EDIT[] = "private/edit";
+static constexpr const char PRIVATE_CANCEL[] = "private/cancel";
+static constexpr const char PRIVATE_GET_POSITIONS[] = "private/get_positions";
+static constexpr const char PUBLIC_AUTH[] = "public/auth";
+static constexpr const char PUBLIC_SET_HEARTBEAT[] = "public/set_heartbeat";
+static constexpr const char PRIVATE_ENABLE_CANCEL_ON_DISCONNECT[] =
+    "private/enable_cancel_on_disconnect";
+static constexpr const char PUBLIC_SUBSCRIBE[] = "public/subscribe";
+}  // namespace methods
+
+namespace grant_types {
+static constexpr const char CLIENT_CREDENTIALS[] = "client_credentials";
+}  // namespace grant_types
+
+namespace scopes {
+static constexpr const char CONNECTION[] = "connection";
+static constexpr const char ACCOUNT[] = "account";
+}  // namespace scopes
+
+namespace order_types {
+static constexpr const char LIMIT[] = "limit";
+static constexpr const char MARKET[] = "market";
+static constexpr const char STOP_LIMIT[] = "stop_limit";
+static constexpr const char STOP_MARKET[] = "stop_market";
+}  // namespace order_types
+
+namespace time_in_force {
+static constexpr const char GTC[] = "good_til_cancelled";
+static constexpr const char IOC[] = "immediate_or_cancel";
+static constexpr const char FOK[] = "fill_or_kill";
+}  // namespace time_in_force
+}  // namespace deribit
+
+struct ALIGNED(32) DeribitOrderRequest {
+  std::string instrument_name;
+  double amount;
+  double price;
+  std::string type;
+  std::string label;
+  bool reduce_only;
+  bool post_only;
+  std::string time_in_force;
+  double max_show;
+};
+
+struct ALIGNED(32) DeribitEditRequest {
+  std::string order_id;
+  double amount;
+  double price;
+  bool post_only;
+  double max_show;
+};
+
+struct ALIGNED(32) DeribitCancelRequest {
+  std::string order_id;
+};
+
+struct AuthCredentials {
+  std::string client_id;
+  std::string client_secret;
+};
+
+// Transparent hash so string keyed maps can be searched by string_view
+struct TransparentStringHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view key) const {
+    return std::hash<std::string_view>{}(key);
+  }
+};
+
+using InstrumentId = uint16_t;
+
+// Interns instrument names into dense ids at startup. Every id owns a
+// pre-rendered "instrument_name":"<name>" fragment, all stored back-to-back
+// in one contiguous table.
+class InstrumentRegistry {
+ public:
+  static constexpr InstrumentId INVALID_ID = 0xFFFF;
+  static constexpr const char* FRAGMENT_PREFIX = "\"instrument_name\":\"";
+
+  InstrumentRegistry() { offsets_.push_back(0); }
+
+  // Return the id of name, interning it first if needed
+  InstrumentId intern(std::string_view name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) return it->second;
+    if (UNLIKELY(size() == INVALID_ID)) return INVALID_ID;
+
+    const InstrumentId id = static_cast<InstrumentId>(size());
+    fragments_.insert(fragments_.end(), FRAGMENT_PREFIX,
+                      FRAGMENT_PREFIX + PREFIX_LEN);
+    fragments_.insert(fragments_.end(), name.begin(), name.end());
+    fragments_.push_back('"');
+    offsets_.push_back(static_cast<uint32_t>(fragments_.size()));
+    ids_.emplace(std::string(name), id);
+    return id;
+  }
+
+  [[nodiscard]] InstrumentId find(std::string_view name) const {
+    auto it = ids_.find(name);
+    return it != ids_.end() ? it->second : INVALID_ID;
+  }
+
+  // Unknown ids (INVALID_ID included) yield an empty fragment
+  [[nodiscard]] FORCE_INLINE std::string_view fragment(InstrumentId id) const {
+    assert(id < size() && "unknown instrument id");
+    if (UNLIKELY(id >= size())) return std::string_view();
+    return std::string_view(fragments_.data() + offsets_[id],
+                            offsets_[id + 1] - offsets_[id]);
+  }
+
+  [[nodiscard]] FORCE_INLINE std::string_view name(InstrumentId id) const {
+    std::string_view frag = fragment(id);
+    if (UNLIKELY(frag.empty())) return frag;
+    return frag.substr(PREFIX_LEN, frag.size() - PREFIX_LEN - 1);
+  }
+
+  [[nodiscard]] FORCE_INLINE size_t size() const {
+    return offsets_.size() - 1;
+  }
+
+ private:
+  static constexpr size_t PREFIX_LEN =
+      std::char_traits<char>::length(FRAGMENT_PREFIX);
+
+  std::vector<char> fragments_;
+  std::vector<uint32_t> offsets_;
+  std::unordered_map<std::string, InstrumentId, TransparentStringHash,
+                     std::equal_to<>>
+      ids_;
+};
+
+// Order request referring to an interned instrument
+struct ALIGNED(32) DeribitInternedOrderRequest {
+  InstrumentId instrument;
+  double amount;
+  double price;
+  std::string type;
+  std::string label;
+  bool reduce_only;
+  bool post_only;
+  std::string time_in_force;
+  double max_show;
+};
+
+// Schema pattern for field serialization
+template <typename T, const char* Name, typename Type, Type T::* Member>
+struct Field {
+  static constexpr const char* name = Name;
+
+  template <typename U>
+  [[nodiscard]] static FORCE_INLINE auto get(const U& obj)
+      -> decltype(static_cast<const T&>(obj).*Member) {
+    return static_cast<const T&>(obj).*Member;
+  }
+};
+
+// Schema pattern
+template <typename... Fields>
+struct Schema {
+  template <typename T, typename BufferType>
+  static FORCE_INLINE void serialize(const T& obj,
+                                     DeribitJsonRpc<BufferType>& serializer) {
+    serialize_fields<0>(obj, serializer);
+  }
+
+  template <size_t I, typename T, typename BufferType>
+  static FORCE_INLINE void serialize_fields(
+      const T& obj, DeribitJsonRpc<BufferType>& serializer) {
+    if constexpr (I < sizeof...(Fields)) {
+      using FieldType =
+          typename std::tuple_element<I, std::tuple<Fields...>>::type;
+      serializer.serialize(FieldType::name, FieldType::get(obj));
+      serialize_fields<I + 1>(obj, serializer);
+    }
+  }
+};
+
+// Schema for Deribit requests
+using BuySellSchema =
+    Schema<Field<DeribitOrderRequest, deribit::fields::INSTRUMENT_NAME,
+                 std::string, &DeribitOrderRequest::instrument_name>,
+           Field<DeribitOrderRequest, deribit::fields::AMOUNT, double,
+                 &DeribitOrderRequest::amount>,
+           Field<DeribitOrderRequest, deribit::fields::PRICE, double,
+                 &DeribitOrderRequest::price>,
+           Field<DeribitOrderRequest, deribit::fields::TYPE, std::string,
+                 &DeribitOrderRequest::type>,
+           Field<DeribitOrderRequest, deribit::fields::LABEL, std::string,
+                 &DeribitOrderRequest::label>,
+           Field<DeribitOrderRequest, deribit::fields::REDUCE_ONLY, bool,
+                 &DeribitOrderRequest::reduce_only>,
+           Field<DeribitOrderRequest, deribit::fields::POST_ONLY, bool,
+                 &DeribitOrderRequest::post_only>,
+           Field<DeribitOrderRequest, deribit::fields::TIME_IN_FORCE,
+                 std::string, &DeribitOrderRequest::time_in_force>,
+           Field<DeribitOrderRequest, deribit::fields::MAX_SHOW, double,
+                 &DeribitOrderRequest::max_show>>;
+
+// Buy/sell fields after the pre-rendered instrument fragment
+using InternedBuySellSchema =
+    Schema<Field<DeribitInternedOrderRequest, deribit::fields::AMOUNT, double,
+                 &DeribitInternedOrderRequest::amount>,
+           Field<DeribitInternedOrderRequest, deribit::fields::PRICE, double,
+                 &DeribitInternedOrderRequest::price>,
+           Field<DeribitInternedOrderRequest, deribit::fields::TYPE,
+                 std::string, &DeribitInternedOrderRequest::type>,
+           Field<DeribitInternedOrderRequest, deribit::fields::LABEL,
+                 std::string, &DeribitInternedOrderRequest::label>,
+           Field<DeribitInternedOrderRequest, deribit::fields::REDUCE_ONLY,
+                 bool, &DeribitInternedOrderRequest::reduce_only>,
+           Field<DeribitInternedOrderRequest, deribit::fields::POST_ONLY, bool,
+                 &DeribitInternedOrderRequest::post_only>,
+           Field<DeribitInternedOrderRequest, deribit::fields::TIME_IN_FORCE,
+                 std::string, &DeribitInternedOrderRequest::time_in_force>,
+           Field<DeribitInternedOrderRequest, deribit::fields::MAX_SHOW,
+                 double, &DeribitInternedOrderRequest::max_show>>;
+
+using EditSchema = Schema<Field<DeribitEditRequest, deribit::fields::ORDER_ID,
+                                std::string, &DeribitEditRequest::order_id>,
+                          Field<DeribitEditRequest, deribit::fields::AMOUNT,
+                                double, &DeribitEditRequest::amount>,
+                          Field<DeribitEditRequest, deribit::fields::PRICE,
+                                double, &DeribitEditRequest::price>,
+                          Field<DeribitEditRequest, deribit::fields::POST_ONLY,
+                                bool, &DeribitEditRequest::post_only>,
+                          Field<DeribitEditRequest, deribit::fields::MAX_SHOW,
+                                double, &DeribitEditRequest::max_show>>;
+
+using CancelSchema =
+    Schema<Field<DeribitCancelRequest, deribit::fields::ORDER_ID, std::string,
+                 &DeribitCancelRequest::order_id>>;
+
+// Outcome of the pre-trade checks fused into serialization
+enum class RiskVerdict : uint8_t {
+  Ok,
+  OutOfRange,
+  OutsideBand,
+  NotionalTooLarge
+};
+
+// Limits consulted by field validators
+struct RiskLimits {
+  double min_amount = 0.0;
+  double max_amount = 1e6;
+  double min_price = 0.0;
+  double max_price = 1e7;
+  double reference_price = 0.0;  // 0 disables the price band check
+  double max_deviation = 0.05;    // band as a fraction of reference_price
+  double max_notional = 1e9;
+};
+
+// Value must lie in [limits.*Min, limits.*Max]
+template <double RiskLimits::* Min, double RiskLimits::* Max>
+struct InRange {
+  template <typename T>
+  static FORCE_INLINE RiskVerdict check(double value, const T&,
+                                        const RiskLimits& limits) {
+    return LIKELY(value >= limits.*Min && value <= limits.*Max)
+               ? RiskVerdict::Ok
+               : RiskVerdict::OutOfRange;
+  }
+};
+
+// Value must stay within max_deviation of the reference price. Passes
+// everything while no reference price is set.
+struct WithinBand {
+  template <typename T>
+  static FORCE_INLINE RiskVerdict check(double value, const T&,
+                                        const RiskLimits& limits) {
+    if (limits.reference_price == 0.0) return RiskVerdict::Ok;
+    const double band = limits.reference_price * limits.max_deviation;
+    return LIKELY(std::abs(value - limits.reference_price) <= band)
+               ? RiskVerdict::Ok
+               : RiskVerdict::OutsideBand;
+  }
+};
+
+// Value times the quantity member of the request must not exceed
+// max_notional
+template <typename T, double T::* Quantity>
+struct MaxNotional {
+  static FORCE_INLINE RiskVerdict check(double value, const T& obj,
+                                        const RiskLimits& limits) {
+    return LIKELY(value * (obj.*Quantity) <= limits.max_notional)
+               ? RiskVerdict::Ok
+               : RiskVerdict::NotionalTooLarge;
+  }
+};
+
+// Field with validators run on the value before it is written
+template <typename FieldType, typename... Validators>
+struct Checked : FieldType {
+  template <typename T, typename Value>
+  static FORCE_INLINE RiskVerdict check(const Value& value, const T& obj,
+                                        const RiskLimits& limits) {
+    RiskVerdict verdict = RiskVerdict::Ok;
+    ((verdict == RiskVerdict::Ok
+          ? (verdict = Validators::check(value, obj, limits))
+          : verdict),
+     ...);
+    return verdict;
+  }
+};
+
+// Schema whose fields may carry validators. Each value is read once,
+// checked and written; the first failing check stops serialization and is
+// returned so the caller can roll the buffer back.
+template <typename... Fields>
+struct CheckedSchema {
+  template <typename T, typename BufferType>
+  static FORCE_INLINE RiskVerdict serialize(
+      const T& obj, DeribitJsonRpc<BufferType>& serializer,
+      const RiskLimits& limits) {
+    return serialize_fields<0>(obj, serializer, limits);
+  }
+
+  template <size_t I, typename T, typename BufferType>
+  static FORCE_INLINE RiskVerdict serialize_fields(
+      const T& obj, DeribitJsonRpc<BufferType>& serializer,
+      const RiskLimits& limits) {
+    if constexpr (I < sizeof...(Fields)) {
+      using FieldType =
+          typename std::tuple_element<I, std::tuple<Fields...>>::type;
+      const auto& value = FieldType::get(obj);
+      if constexpr (requires { FieldType::check(value, obj, limits); }) {
+        RiskVerdict verdict = FieldType::check(value, obj, limits);
+        if (UNLIKELY(verdict != RiskVerdict::Ok)) return verdict;
+      }
+      serializer.serialize(FieldType::name, value);
+      return serialize_fields<I + 1>(obj, serializer, limits);
+    } else {
+      return RiskVerdict::Ok;
+    }
+  }
+};
+
+// BuySellSchema with pre-trade checks on amount and price
+using CheckedBuySellSchema = CheckedSchema<
+    Field<DeribitOrderRequest, deribit::fields::INSTRUMENT_NAME, std::string,
+          &DeribitOrderRequest::instrument_name>,
+    Checked<Field<DeribitOrderRequest, deribit::fields::AMOUNT, double,
+                  &DeribitOrderRequest::amount>,
+            InRange<&RiskLimits::min_amount, &RiskLimits::max_amount>>,
+    Checked<Field<DeribitOrderRequest, deribit::fields::PRICE, double,
+                  &DeribitOrderRequest::price>,
+            InRange<&RiskLimits::min_price, &RiskLimits::max_price>,
+            WithinBand,
+            MaxNotional<DeribitOrderRequest, &DeribitOrderRequest::amount>>,
+    Field<DeribitOrderRequest, deribit::fields::TYPE, std::string,
+          &DeribitOrderRequest::type>,
+    Field<DeribitOrderRequest, deribit::fields::LABEL, std::string,
+          &DeribitOrderRequest::label>,
+    Field<DeribitOrderRequest, deribit::fields::REDUCE_ONLY, bool,
+          &DeribitOrderRequest::reduce_only>,
+    Field<DeribitOrderRequest, deribit::fields::POST_ONLY, bool,
+          &DeribitOrderRequest::post_only>,
+    Field<DeribitOrderRequest, deribit::fields::TIME_IN_FORCE, std::string,
+          &DeribitOrderRequest::time_in_force>,
+    Field<DeribitOrderRequest, deribit::fields::MAX_SHOW, double,
+          &DeribitOrderRequest::max_show>>;
+
+// Schema whose emitted fields are picked by a runtime bitmask, bit I
+// selecting field I. Every mask gets its own unrolled serializer in a table
+// built at compile time, so a subset costs one indirect call and no
+// per-field branches.
+template <typename... Fields>
+struct MaskedSchema {
+  static constexpr uint32_t ALL_FIELDS = (1u << sizeof...(Fields)) - 1;
+
+  template <typename T, typename BufferType>
+  static FORCE_INLINE void serialize(const T& obj, uint32_t mask,
+                                     DeribitJsonRpc<BufferType>& serializer) {
+    table<T, BufferType>[mask & ALL_FIELDS](obj, serializer);
+  }
+
+ private:
+  template <typename T, typename BufferType>
+  using SerializeFn = void (*)(const T&, DeribitJsonRpc<BufferType>&);
+
+  template <uint32_t Mask, size_t I, typename T, typename BufferType>
+  static FORCE_INLINE void serialize_fields(
+      const T& obj, DeribitJsonRpc<BufferType>& serializer) {
+    if constexpr (I < sizeof...(Fields)) {
+      if constexpr ((Mask & (1u << I)) != 0) {
+        using FieldType =
+            typename std::tuple_element<I, std::tuple<Fields...>>::type;
+        serializer.serialize(FieldType::name, FieldType::get(obj));
+      }
+      serialize_fields<Mask, I + 1>(obj, serializer);
+    }
+  }
+
+  template <uint32_t Mask, typename T, typename BufferType>
+  static void serialize_mask(const T& obj,
+                             DeribitJsonRpc<BufferType>& serializer) {
+    serialize_fields<Mask, 0>(obj, serializer);
+  }
+
+  template <typename T, typename BufferType, size_t... Masks>
+  static constexpr auto make_table(std::index_sequence<Masks...>) {
+    return std::array<SerializeFn<T, BufferType>, sizeof...(Masks)>{
+        &serialize_mask<Masks, T, BufferType>...};
+  }
+
+  template <typename T, typename BufferType>
+  static constexpr auto table = make_table<T, BufferType>(
+      std::make_index_sequence<ALL_FIELDS + 1>{});
+};
+
+template <typename SchemaType>
+struct to_masked;
+
+template <typename... Fields>
+struct to_masked<Schema<Fields...>> {
+  using type = MaskedSchema<Fields...>;
+};
+
+using MaskedEditSchema = to_masked<EditSchema>::type;
+
+// EditSchema field bits, in schema order
+namespace edit_fields {
+static constexpr uint32_t ORDER_ID = 1u << 0;
+static constexpr uint32_t AMOUNT = 1u << 1;
+static constexpr uint32_t PRICE = 1u << 2;
+static constexpr uint32_t POST_ONLY = 1u << 3;
+static constexpr uint32_t MAX_SHOW = 1u << 4;
+// Deribit needs the order id and amount on every edit
+static constexpr uint32_t REQUIRED = ORDER_ID | AMOUNT;
+}  // namespace edit_fields
+
+// Order that tracks which edit fields differ from the last state the
+// exchange acknowledged. Setting a field back to its acknowledged value
+// clears its bit again.
+class TrackedOrder {
+ public:
+  explicit TrackedOrder(DeribitEditRequest acked)
+      : state_(std::move(acked)), acked_(baseline(state_)), dirty_(0) {}
+
+  FORCE_INLINE void set_amount(double amount) {
+    state_.amount = amount;
+    mark(edit_fields::AMOUNT, amount != acked_.amount);
+  }
+
+  FORCE_INLINE void set_price(double price) {
+    state_.price = price;
+    mark(edit_fields::PRICE, price != acked_.price);
+  }
+
+  FORCE_INLINE void set_post_only(bool post_only) {
+    state_.post_only = post_only;
+    mark(edit_fields::POST_ONLY, post_only != acked_.post_only);
+  }
+
+  FORCE_INLINE void set_max_show(double max_show) {
+    state_.max_show = max_show;
+    mark(edit_fields::MAX_SHOW, max_show != acked_.max_show);
+  }
+
+  // Exchange confirmed the current state; it becomes the new baseline
+  FORCE_INLINE void acknowledge() {
+    acked_ = baseline(state_);
+    dirty_ = 0;
+  }
+
+  [[nodiscard]] FORCE_INLINE const DeribitEditRequest& state() const {
+    return state_;
+  }
+
+  [[nodiscard]] FORCE_INLINE uint32_t dirty() const { return dirty_; }
+
+ private:
+  // The editable fields as last acknowledged; the order id never changes
+  struct Acked {
+    double amount;
+    double price;
+    double max_show;
+    bool post_only;
+  };
+
+  static FORCE_INLINE Acked baseline(const DeribitEditRequest& req) {
+    return Acked{req.amount, req.price, req.max_show, req.post_only};
+  }
+
+  FORCE_INLINE void mark(uint32_t field, bool changed) {
+    dirty_ = changed ? (dirty_ | field) : (dirty_ & ~field);
+  }
+
+  DeribitEditRequest state_;
+  Acked acked_;
+  uint32_t dirty_;
+};
+
+// Session setup requests, shared by DeribitClient and the reconnect bundle
+template <typename BufferType>
+FORCE_INLINE void write_auth_request(DeribitJsonRpc<BufferType>& rpc, int id,
+                                     const AuthCredentials& credentials) {
+  rpc.begin_json_rpc(deribit::methods::PUBLIC_AUTH, id);
+  rpc.serialize(deribit::fields::GRANT_TYPE,
+                deribit::grant_types::CLIENT_CREDENTIALS);
+  rpc.serialize(deribit::fields::CLIENT_ID, credentials.client_id);
+  rpc.serialize(deribit::fields::CLIENT_SECRET, credentials.client_secret);
+  rpc.end_json_rpc();
+}
+
+template <typename BufferType>
+FORCE_INLINE void write_set_heartbeat_request(DeribitJsonRpc<BufferType>& rpc,
+                                              int id, int interval_seconds) {
+  rpc.begin_json_rpc(deribit::methods::PUBLIC_SET_HEARTBEAT, id);
+  rpc.serialize(deribit::fields::INTERVAL, interval_seconds);
+  rpc.end_json_rpc();
+}
+
+template <typename BufferType>
+FORCE_INLINE void write_enable_cancel_on_disconnect_request(
+    DeribitJsonRpc<BufferType>& rpc, int id) {
+  rpc.begin_json_rpc(deribit::methods::PRIVATE_ENABLE_CANCEL_ON_DISCONNECT,
+                     id);
+  rpc.serialize(deribit::fields::SCOPE, deribit::scopes::CONNECTION);
+  rpc.end_json_rpc();
+}
+
+template <typename BufferType>
+FORCE_INLINE void write_subscribe_request(
+    DeribitJsonRpc<BufferType>& rpc, int id,
+    std::span<const std::string> channels) {
+  rpc.begin_json_rpc(deribit::methods::PUBLIC_SUBSCRIBE, id);
+  rpc.serialize(deribit::fields::CHANNELS, channels);
+  rpc.end_json_rpc();
+}
+
+// Deribit API client class
+class ALIGNED(64) DeribitClient {
+ public:
+  DeribitClient() : buffer_(8192), request_id_(1) {}
+
+  // Prevent copies, allow moves
+  DeribitClient(const DeribitClient&) = delete;
+  DeribitClient& operator=(const DeribitClient&) = delete;
+  DeribitClient(DeribitClient&&) noexcept = default;
+  DeribitClient& operator=(DeribitClient&&) noexcept = default;
+
+  // Create buy order JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view create_buy_request(
+      const DeribitOrderRequest& req) {
+    TRACE_SCOPE(Serialize, request_id_);
+    start(runtime_stats::Kind::Place);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_BUY, request_id_++);
+    BuySellSchema::serialize(req, rpc);
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Place);
+  }
+
+  // Create sell order JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view create_sell_request(
+      const DeribitOrderRequest& req) {
+    TRACE_SCOPE(Serialize, request_id_);
+    start(runtime_stats::Kind::Place);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_SELL, request_id_++);
+    BuySellSchema::serialize(req, rpc);
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Place);
+  }
+
+  // Create buy order JSON-RPC with the pre-trade checks evaluated during
+  // serialization. A failed check rolls the buffer and request id back and
+  // returns an empty view.
+  [[nodiscard]] FORCE_INLINE std::string_view create_buy_request(
+      const DeribitOrderRequest& req, const RiskLimits& limits,
+      RiskVerdict& verdict) {
+    return create_checked_request(deribit::methods::PRIVATE_BUY, req, limits,
+                                  verdict);
+  }
+
+  // Create sell order JSON-RPC with fused pre-trade checks
+  [[nodiscard]] FORCE_INLINE std::string_view create_sell_request(
+      const DeribitOrderRequest& req, const RiskLimits& limits,
+      RiskVerdict& verdict) {
+    return create_checked_request(deribit::methods::PRIVATE_SELL, req, limits,
+                                  verdict);
+  }
+
+  // Create buy order JSON-RPC for an interned instrument. An id the
+  // registry does not know returns an empty view and consumes no request id.
+  [[nodiscard]] FORCE_INLINE std::string_view create_buy_request(
+      const DeribitInternedOrderRequest& req,
+      const InstrumentRegistry& instruments) {
+    TRACE_SCOPE(Serialize, request_id_);
+    assert(req.instrument < instruments.size() && "unknown instrument id");
+    if (UNLIKELY(req.instrument >= instruments.size()))
+      return std::string_view();
+    start(runtime_stats::Kind::Place);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_BUY, request_id_++);
+    rpc.serialize_fragment(instruments.fragment(req.instrument));
+    InternedBuySellSchema::serialize(req, rpc);
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Place);
+  }
+
+  // Create sell order JSON-RPC for an interned instrument. An id the
+  // registry does not know returns an empty view and consumes no request id.
+  [[nodiscard]] FORCE_INLINE std::string_view create_sell_request(
+      const DeribitInternedOrderRequest& req,
+      const InstrumentRegistry& instruments) {
+    TRACE_SCOPE(Serialize, request_id_);
+    assert(req.instrument < instruments.size() && "unknown instrument id");
+    if (UNLIKELY(req.instrument >= instruments.size()))
+      return std::string_view();
+    start(runtime_stats::Kind::Place);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_SELL, request_id_++);
+    rpc.serialize_fragment(instruments.fragment(req.instrument));
+    InternedBuySellSchema::serialize(req, rpc);
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Place);
+  }
+
+  // Create edit order JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view create_edit_request(
+      const DeribitEditRequest& req) {
+    TRACE_SCOPE(Serialize, request_id_);
+    start(runtime_stats::Kind::Edit);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_EDIT, request_id_++);
+    EditSchema::serialize(req, rpc);
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Edit);
+  }
+
+  // Create edit order JSON-RPC with only the changed fields plus the
+  // required ones
+  [[nodiscard]] FORCE_INLINE std::string_view create_edit_request(
+      const TrackedOrder& order) {
+    start(runtime_stats::Kind::Edit);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_EDIT, request_id_++);
+    MaskedEditSchema::serialize(
+        order.state(), order.dirty() | edit_fields::REQUIRED, rpc);
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Edit);
+  }
+
+  // Create cancel order JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view create_cancel_request(
+      const DeribitCancelRequest& req) {
+    TRACE_SCOPE(Serialize, request_id_);
+    start(runtime_stats::Kind::Cancel);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_CANCEL, request_id_++);
+    CancelSchema::serialize(req, rpc);
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Cancel);
+  }
+
+  // Create get positions JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view create_get_positions_request() {
+    start(runtime_stats::Kind::Other);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_GET_POSITIONS, request_id_++);
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Other);
+  }
+
+  // Create auth JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view create_auth_request(
+      const AuthCredentials& credentials) {
+    start(runtime_stats::Kind::Session);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+    write_auth_request(rpc, request_id_++, credentials);
+    return finish(runtime_stats::Kind::Session);
+  }
+
+  // Create set heartbeat JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view create_set_heartbeat_request(
+      int interval_seconds) {
+    start(runtime_stats::Kind::Session);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+    write_set_heartbeat_request(rpc, request_id_++, interval_seconds);
+    return finish(runtime_stats::Kind::Session);
+  }
+
+  // Create enable cancel on disconnect JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view
+  create_enable_cancel_on_disconnect_request() {
+    start(runtime_stats::Kind::Session);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+    write_enable_cancel_on_disconnect_request(rpc, request_id_++);
+    return finish(runtime_stats::Kind::Session);
+  }
+
+  // Create subscribe JSON-RPC
+  [[nodiscard]] FORCE_INLINE std::string_view create_subscribe_request(
+      std::span<const std::string> channels) {
+    start(runtime_stats::Kind::Session);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+    write_subscribe_request(rpc, request_id_++, channels);
+    return finish(runtime_stats::Kind::Session);
+  }
+
+  // Manual serialization function for comparison with schema-based approach
+  [[nodiscard]] FORCE_INLINE std::string_view create_buy_request_manual(
+      const DeribitOrderRequest& req) {
+    start(runtime_stats::Kind::Place);
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(deribit::methods::PRIVATE_BUY, request_id_++);
+
+    // Manually serialize each field (no schema)
+    rpc.serialize(deribit::fields::INSTRUMENT_NAME, req.instrument_name);
+    rpc.serialize(deribit::fields::AMOUNT, req.amount);
+    rpc.serialize(deribit::fields::PRICE, req.price);
+    rpc.serialize(deribit::fields::TYPE, req.type);
+    rpc.serialize(deribit::fields::LABEL, req.label);
+    rpc.serialize(deribit::fields::REDUCE_ONLY, req.reduce_only);
+    rpc.serialize(deribit::fields::POST_ONLY, req.post_only);
+    rpc.serialize(deribit::fields::TIME_IN_FORCE, req.time_in_force);
+    rpc.serialize(deribit::fields::MAX_SHOW, req.max_show);
+
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Place);
+  }
+
+  // Reserve a contiguous block of request ids for batched APIs
+  [[nodiscard]] FORCE_INLINE int reserve_request_ids(int count) {
+    int first = request_id_;
+    request_id_ += count;
+    return first;
+  }
+
+  // Count every request in block, normally the owning thread's
+  // runtime_stats::register_thread(); nullptr turns counting off
+  FORCE_INLINE void set_stats(runtime_stats::Block* block) { stats_ = block; }
+
+ private:
+  FORCE_INLINE void start(runtime_stats::Kind kind) {
+    SERIALIZER_PROBE2(message_start, static_cast<int>(kind), request_id_);
+    buffer_.reset();
+  }
+
+  FORCE_INLINE std::string_view finish(runtime_stats::Kind kind) {
+    SERIALIZER_PROBE3(message_end, static_cast<int>(kind), request_id_ - 1,
+                      buffer_.size());
+    if (stats_) {
+      runtime_stats::record(*stats_, kind, buffer_.size(), buffer_.capacity());
+    }
+    return buffer_.view();
+  }
+
+  FORCE_INLINE std::string_view create_checked_request(
+      const char* method, const DeribitOrderRequest& req,
+      const RiskLimits& limits, RiskVerdict& verdict) {
+    start(runtime_stats::Kind::Place);
+    const size_t mark = buffer_.size();
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+
+    rpc.begin_json_rpc(method, request_id_++);
+    verdict = CheckedBuySellSchema::serialize(req, rpc, limits);
+    if (UNLIKELY(verdict != RiskVerdict::Ok)) {
+      buffer_.rewind(mark);
+      --request_id_;
+      SERIALIZER_PROBE2(message_rejected, request_id_,
+                        static_cast<int>(verdict));
+      return std::string_view();
+    }
+    rpc.end_json_rpc();
+
+    return finish(runtime_stats::Kind::Place);
+  }
+
+  Buffer buffer_;
+  int request_id_;
+  runtime_stats::Block* stats_ = nullptr;
+};
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// Minimal file descriptor transport. Batched frames are passed as iovecs so
+// they leave in as few writev calls as the kernel allows.
+class FdTransport {
+ public:
+  explicit FdTransport(int fd) : fd_(fd) {}
+
+  FORCE_INLINE bool send(std::string_view frame) {
+    TRACE_SCOPE(SendSyscall, frame.size());
+    while (!frame.empty()) {
+      ssize_t written = ::write(fd_, frame.data(), frame.size());
+      if (UNLIKELY(written < 0)) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+      frame.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+  }
+
+  bool send(std::span<const iovec> frames) {
+    TRACE_SCOPE(SendSyscall, frames.size());
+    while (!frames.empty()) {
+      const size_t count = std::min<size_t>(frames.size(), IOV_MAX);
+      ssize_t written = ::writev(fd_, frames.data(), static_cast<int>(count));
+      if (UNLIKELY(written < 0)) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+
+      // Skip fully written iovecs, finish a partially written one by hand
+      size_t left = static_cast<size_t>(written);
+      size_t i = 0;
+      while (i < count && left >= frames[i].iov_len) {
+        left -= frames[i].iov_len;
+        ++i;
+      }
+      if (i < count && left > 0) {
+        const char* base = static_cast<const char*>(frames[i].iov_base);
+        if (!send(std::string_view(base + left, frames[i].iov_len - left))) {
+          return false;
+        }
+        ++i;
+      }
+      frames = frames.subspan(i);
+    }
+    return true;
+  }
+
+  [[nodiscard]] FORCE_INLINE int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+// One instrument in a bulk requote
+struct RequoteEntry {
+  std::string_view order_id;
+  double price;
+  double amount;
+  double max_show;
+};
+
+// Location of one frame inside a batch region
+struct FrameRef {
+  uint32_t offset;
+  uint32_t size;
+};
+
+// Renders many private/edit frames back-to-back into a single region, with
+// the same fields in the same order as EditSchema. Literals are
+// pre-rendered once, all numbers are formatted in a first pass
+// and the frames are then assembled with plain copies into space reserved
+// up front. The result is exposed both as a frame index and as iovecs for a
+// single gather write.
+class BulkRequoter {
+ public:
+  static constexpr const char* EDIT_PREFIX =
+      "{\"jsonrpc\":\"2.0\",\"method\":\"private/edit\",\"id\":";
+  static constexpr const char* EDIT_ORDER_ID = ",\"params\":{\"order_id\":\"";
+  static constexpr const char* EDIT_AMOUNT = "\",\"amount\":";
+  static constexpr const char* EDIT_PRICE = ",\"price\":";
+  static constexpr const char* EDIT_POST_ONLY = ",\"post_only\":true";
+  static constexpr const char* EDIT_PASSIVE = ",\"post_only\":false";
+  static constexpr const char* EDIT_MAX_SHOW = ",\"max_show\":";
+  static constexpr const char* EDIT_TAIL = "}}";
+
+  explicit BulkRequoter(bool post_only = true, size_t capacity = 64 * 1024)
+      : buffer_(capacity),
+        post_only_(post_only ? EDIT_POST_ONLY : EDIT_PASSIVE),
+        post_only_len_(std::strlen(post_only_)) {}
+
+  // Render one edit frame per entry using consecutive request ids starting
+  // at first_request_id. Returns one iovec per frame.
+  std::span<const iovec> requote(std::span<const RequoteEntry> entries,
+                                 int first_request_id) {
+    const size_t count = entries.size();
+    buffer_.reset();
+    numbers_.resize(count);
+    frames_.resize(count);
+    iovecs_.resize(count);
+
+    // Pass 1: format every number and size the whole batch
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+      NumberSlot& slot = numbers_[i];
+      slot.id_len = format(slot.id, first_request_id + static_cast<int>(i));
+      slot.amount_len = format(slot.amount, entries[i].amount);
+      slot.price_len = format(slot.price, entries[i].price);
+      slot.max_show_len = format(slot.max_show, entries[i].max_show);
+      total += FIXED_SIZE + slot.id_len + slot.amount_len + slot.price_len +
+               slot.max_show_len + entries[i].order_id.size();
+    }
+    // Grow with headroom, so later batches with slightly wider numbers
+    // still fit
+    if (UNLIKELY(total > buffer_.capacity())) {
+      buffer_.reserve(total + total / 2);
+    }
+
+    // Pass 2: assemble frames with unchecked copies
+    char* out = buffer_.current();
+    char* const base = out;
+    for (size_t i = 0; i < count; ++i) {
+      const NumberSlot& slot = numbers_[i];
+      const std::string_view order_id = entries[i].order_id;
+      char* frame = out;
+
+      out = copy(out, EDIT_PREFIX, PREFIX_LEN);
+      out = copy(out, slot.id, slot.id_len);
+      out = copy(out, EDIT_ORDER_ID, ORDER_ID_LEN);
+      out = copy(out, order_id.data(), order_id.size());
+      out = copy(out, EDIT_AMOUNT, AMOUNT_LEN);
+      out = copy(out, slot.amount, slot.amount_len);
+      out = copy(out, EDIT_PRICE, PRICE_LEN);
+      out = copy(out, slot.price, slot.price_len);
+      out = copy(out, post_only_, post_only_len_);
+      out = copy(out, EDIT_MAX_SHOW, MAX_SHOW_LEN);
+      out = copy(out, slot.max_show, slot.max_show_len);
+      out = copy(out, EDIT_TAIL, TAIL_LEN);
+
+      frames_[i] = FrameRef{static_cast<uint32_t>(frame - base),
+                            static_cast<uint32_t>(out - frame)};
+      iovecs_[i] = iovec{frame, static_cast<size_t>(out - frame)};
+    }
+    buffer_.size() += static_cast<size_t>(out - base);
+
+    return iovecs_;
+  }
+
+  [[nodiscard]] FORCE_INLINE size_t frame_count() const {
+    return frames_.size();
+  }
+
+  [[nodiscard]] FORCE_INLINE std::string_view frame(size_t i) const {
+    return std::string_view(buffer_.data() + frames_[i].offset,
+                            frames_[i].size);
+  }
+
+  [[nodiscard]] FORCE_INLINE std::span<const FrameRef> frames() const {
+    return frames_;
+  }
+
+  [[nodiscard]] FORCE_INLINE std::span<const iovec> iovecs() const {
+    return iovecs_;
+  }
+
+  [[nodiscard]] FORCE_INLINE std::string_view view() const {
+    return buffer_.view();
+  }
+
+ private:
+  static constexpr size_t MAX_NUMBER_CHARS = 32;
+  static constexpr size_t PREFIX_LEN =
+      std::char_traits<char>::length(EDIT_PREFIX);
+  static constexpr size_t ORDER_ID_LEN =
+      std::char_traits<char>::length(EDIT_ORDER_ID);
+  static constexpr size_t AMOUNT_LEN =
+      std::char_traits<char>::length(EDIT_AMOUNT);
+  static constexpr size_t PRICE_LEN =
+      std::char_traits<char>::length(EDIT_PRICE);
+  static constexpr size_t MAX_SHOW_LEN =
+      std::char_traits<char>::length(EDIT_MAX_SHOW);
+  static constexpr size_t TAIL_LEN = std::char_traits<char>::length(EDIT_TAIL);
+  static constexpr size_t FIXED_SIZE =
+      PREFIX_LEN + ORDER_ID_LEN + AMOUNT_LEN + PRICE_LEN +
+      std::char_traits<char>::length(EDIT_PASSIVE) + MAX_SHOW_LEN + TAIL_LEN;
+
+  struct NumberSlot {
+    char id[16];
+    char amount[MAX_NUMBER_CHARS];
+    char price[MAX_NUMBER_CHARS];
+    char max_show[MAX_NUMBER_CHARS];
+    uint8_t id_len;
+    uint8_t amount_len;
+    uint8_t price_len;
+    uint8_t max_show_len;
+  };
+
+  template <size_t N, typename T>
+  static FORCE_INLINE uint8_t format(char (&buf)[N], T value) {
+    auto [ptr, ec] = std::to_chars(buf, buf + N, value);
+    return LIKELY(ec == std::errc()) ? static_cast<uint8_t>(ptr - buf) : 0;
+  }
+
+  static FORCE_INLINE char* copy(char* out, const char* src, size_t len) {
+    std::memcpy(out, src, len);
+    return out + len;
+  }
+
+  Buffer buffer_;
+  const char* post_only_;
+  size_t post_only_len_;
+  std::vector<NumberSlot> numbers_;
+  std::vector<FrameRef> frames_;
+  std::vector<iovec> iovecs_;
+};
+
+// Outcome of queueing an edit in the coalescer
+enum class CoalesceResult : uint8_t { Queued, Replaced, Rejected };
+
+// Send-side queue of private/edit frames keyed by order id. Mutable values
+// are rendered into fixed-width, space-padded slots (valid JSON whitespace),
+// so a newer edit for an order that is still queued overwrites the pending
+// frame in place. The frame keeps its queue position and request id and
+// only the latest amendment ever reaches the wire.
+class EditCoalescer {
+ public:
+  static constexpr size_t NUMBER_WIDTH = 16;
+  static constexpr size_t FLAG_WIDTH = 5;
+  static constexpr size_t FRAME_SLOT = 256;
+
+  explicit EditCoalescer(size_t capacity = 1024)
+      : slots_(capacity * FRAME_SLOT),
+        meta_(capacity),
+        capacity_(capacity),
+        head_(0),
+        tail_(0),
+        replaced_(0),
+        sent_frames_(0),
+        sent_bytes_(0) {
+    pending_.reserve(capacity);
+    iovecs_.reserve(capacity);
+    draining_.reserve(capacity);
+  }
+
+  // Queue an edit or patch the pending frame for the same order. On
+  // Rejected nothing changed: a pending frame for the order stays queued.
+  CoalesceResult submit(const DeribitEditRequest& req, int request_id,
+                        int64_t now_ns = 0) {
+    auto it = pending_.find(std::string_view(req.order_id));
+    if (it != pending_.end()) {
+      SlotMeta& meta = meta_[it->second];
+      char* frame = slot(it->second);
+      if (LIKELY(patch(frame, meta, req))) {
+        meta.submitted_ns = now_ns;
+        ++replaced_;
+        return CoalesceResult::Replaced;
+      }
+      // Value does not fit the slot; supersede the old frame below, once
+      // the new one is in place
+    }
+
+    if (UNLIKELY(tail_ - head_ == capacity_)) {
+      return CoalesceResult::Rejected;
+    }
+
+    const uint32_t index = static_cast<uint32_t>(tail_ % capacity_);
+    if (UNLIKELY(!render(slot(index), meta_[index], req, request_id))) {
+      return CoalesceResult::Rejected;
+    }
+    meta_[index].submitted_ns = now_ns;
+    if (it != pending_.end()) {
+      meta_[it->second].live = false;
+      it->second = index;
+    } else {
+      pending_.emplace(req.order_id, index);
+    }
+    ++tail_;
+    return CoalesceResult::Queued;
+  }
+
+  // Send up to max_frames of the oldest pending frames in one gather write.
+  // Returns the number sent, or -1 if the write failed; the frames then
+  // stay pending, still coalescing, for the next drain. Latencies from
+  // submit to send are recorded into latencies if given.
+  ssize_t drain(FdTransport& transport, size_t max_frames, int64_t now_ns = 0,
+                LatencyRecorder* latencies = nullptr) {
+    iovecs_.clear();
+    draining_.clear();
+    uint64_t cursor = head_;
+    while (cursor != tail_ && iovecs_.size() < max_frames) {
+      const uint32_t index = static_cast<uint32_t>(cursor++ % capacity_);
+      const SlotMeta& meta = meta_[index];
+      if (!meta.live) continue;
+      iovecs_.push_back(iovec{slot(index), meta.size});
+      draining_.push_back(index);
+    }
+    if (!iovecs_.empty() && UNLIKELY(!transport.send(iovecs_))) return -1;
+
+    // On the wire: only now retire the frames
+    head_ = cursor;
+    for (uint32_t index : draining_) {
+      SlotMeta& meta = meta_[index];
+      pending_.erase(pending_.find(std::string_view(
+          slot(index) + meta.order_id_offset, meta.order_id_size)));
+      meta.live = false;
+      sent_bytes_ += meta.size;
+      if (latencies) latencies->record_ns(now_ns - meta.submitted_ns);
+    }
+    sent_frames_ += draining_.size();
+    return static_cast<ssize_t>(draining_.size());
+  }
+
+  [[nodiscard]] FORCE_INLINE size_t pending() const { return pending_.size(); }
+  [[nodiscard]] FORCE_INLINE uint64_t replaced() const { return replaced_; }
+  [[nodiscard]] FORCE_INLINE uint64_t sent_frames() const {
+    return sent_frames_;
+  }
+  [[nodiscard]] FORCE_INLINE uint64_t sent_bytes() const { return sent_bytes_; }
+
+ private:
+  struct SlotMeta {
+    uint16_t size;
+    uint16_t order_id_offset;
+    uint16_t order_id_size;
+    uint16_t amount_offset;
+    uint16_t price_offset;
+    uint16_t post_only_offset;
+    uint16_t max_show_offset;
+    bool live;
+    int64_t submitted_ns;
+  };
+
+  FORCE_INLINE char* slot(uint32_t index) {
+    return slots_.data() + static_cast<size_t>(index) * FRAME_SLOT;
+  }
+
+  // Right-align text in a space-padded slot
+  static FORCE_INLINE bool fill_slot(char* out, size_t width, const char* text,
+                                     size_t len) {
+    if (UNLIKELY(len > width)) return false;
+    std::memset(out, ' ', width - len);
+    std::memcpy(out + width - len, text, len);
+    return true;
+  }
+
+  static FORCE_INLINE bool fill_slot(char* out, double value) {
+    char buf[32];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    return LIKELY(ec == std::errc()) &&
+           fill_slot(out, NUMBER_WIDTH, buf, ptr - buf);
+  }
+
+  static FORCE_INLINE bool fill_slot(char* out, bool value) {
+    return value ? fill_slot(out, FLAG_WIDTH, "true", 4)
+                 : fill_slot(out, FLAG_WIDTH, "false", 5);
+  }
+
+  static FORCE_INLINE bool patch(char* frame, const SlotMeta& meta,
+                                 const DeribitEditRequest& req) {
+    char scratch[NUMBER_WIDTH * 3 + FLAG_WIDTH];
+    // Validate every value before touching the queued frame
+    if (!fill_slot(scratch, req.amount) ||
+        !fill_slot(scratch + NUMBER_WIDTH, req.price) ||
+        !fill_slot(scratch + NUMBER_WIDTH * 2, req.max_show)) {
+      return false;
+    }
+    fill_slot(scratch + NUMBER_WIDTH * 3, req.post_only);
+    std::memcpy(frame + meta.amount_offset, scratch, NUMBER_WIDTH);
+    std::memcpy(frame + meta.price_offset, scratch + NUMBER_WIDTH,
+                NUMBER_WIDTH);
+    std::memcpy(frame + meta.max_show_offset, scratch + NUMBER_WIDTH * 2,
+                NUMBER_WIDTH);
+    std::memcpy(frame + meta.post_only_offset, scratch + NUMBER_WIDTH * 3,
+                FLAG_WIDTH);
+    return true;
+  }
+
+  static bool render(char* frame, SlotMeta& meta,
+                     const DeribitEditRequest& req, int request_id) {
+    size_t pos = 0;
+    auto put = [&](const char* text, size_t len) {
+      if (pos + len > FRAME_SLOT) return false;
+      std::memcpy(frame + pos, text, len);
+      pos += len;
+      return true;
+    };
+    auto put_str = [&](const char* text) {
+      return put(text, std::strlen(text));
+    };
+    auto reserve_slot = [&](size_t width, uint16_t& offset) {
+      if (pos + width > FRAME_SLOT) return false;
+      offset = static_cast<uint16_t>(pos);
+      pos += width;
+      return true;
+    };
+
+    char id_buf[16];
+    auto [id_end, ec] = std::to_chars(id_buf, id_buf + sizeof(id_buf),
+                                      request_id);
+    if (UNLIKELY(ec != std::errc())) return false;
+
+    bool ok = put_str(BulkRequoter::EDIT_PREFIX) &&
+              put(id_buf, id_end - id_buf) &&
+              put_str(BulkRequoter::EDIT_ORDER_ID);
+    meta.order_id_offset = static_cast<uint16_t>(pos);
+    meta.order_id_size = static_cast<uint16_t>(req.order_id.size());
+    ok = ok && put(req.order_id.data(), req.order_id.size()) &&
+         put_str(BulkRequoter::EDIT_AMOUNT) &&
+         reserve_slot(NUMBER_WIDTH, meta.amount_offset) &&
+         put_str(BulkRequoter::EDIT_PRICE) &&
+         reserve_slot(NUMBER_WIDTH, meta.price_offset) &&
+         put_str(",\"post_only\":") &&
+         reserve_slot(FLAG_WIDTH, meta.post_only_offset) &&
+         put_str(",\"max_show\":") &&
+         reserve_slot(NUMBER_WIDTH, meta.max_show_offset) && put("}}", 2);
+    if (UNLIKELY(!ok || !patch(frame, meta, req))) return false;
+
+    meta.size = static_cast<uint16_t>(pos);
+    meta.live = true;
+    return true;
+  }
+
+  std::vector<char> slots_;
+  std::vector<SlotMeta> meta_;
+  std::unordered_map<std::string, uint32_t, TransparentStringHash, std::equal_to<>>
+      pending_;
+  std::vector<iovec> iovecs_;
+  std::vector<uint32_t> draining_;  // slots in iovecs_, in order
+  size_t capacity_;
+  uint64_t head_;
+  uint64_t tail_;
+  uint64_t replaced_;
+  uint64_t sent_frames_;
+  uint64_t sent_bytes_;
+};
+
+// Keeps a ready-to-send private/cancel frame for every live order. Frames
+// are rendered when the order is acknowledged with a fixed-width request id
+// slot, so a panic cancel only patches ids and issues one gather write.
+// Live frames stay dense: closing an order moves the last frame into its
+// slot.
+class CancelRegistry {
+ public:
+  static constexpr const char* CANCEL_PREFIX =
+      "{\"jsonrpc\":\"2.0\",\"method\":\"private/cancel\",\"id\":";
+  static constexpr const char* CANCEL_ORDER_ID = ",\"params\":{\"order_id\":\"";
+  static constexpr const char* CANCEL_TAIL = "\"}}";
+  static constexpr size_t ID_WIDTH = 10;
+  static constexpr size_t FRAME_SLOT = 128;
+
+  explicit CancelRegistry(size_t capacity = 4096)
+      : slots_(capacity * FRAME_SLOT),
+        sizes_(capacity),
+        iovecs_(capacity),
+        capacity_(capacity),
+        live_(0) {
+    index_.reserve(capacity);
+  }
+
+  // Render the cancel frame for a newly acknowledged order
+  bool on_order_acknowledged(std::string_view order_id) {
+    if (UNLIKELY(live_ == capacity_ ||
+                 ORDER_ID_OFFSET + order_id.size() + TAIL_LEN > FRAME_SLOT)) {
+      return false;
+    }
+    if (!index_.emplace(std::string(order_id), live_).second) return false;
+
+    char* frame = slot(live_);
+    std::memcpy(frame, CANCEL_PREFIX, PREFIX_LEN);
+    std::memset(frame + PREFIX_LEN, ' ', ID_WIDTH);
+    std::memcpy(frame + PREFIX_LEN + ID_WIDTH, CANCEL_ORDER_ID, ORDER_ID_LEN);
+    std::memcpy(frame + ORDER_ID_OFFSET, order_id.data(), order_id.size());
+    std::memcpy(frame + ORDER_ID_OFFSET + order_id.size(), CANCEL_TAIL,
+                TAIL_LEN);
+    sizes_[live_] =
+        static_cast<uint16_t>(ORDER_ID_OFFSET + order_id.size() + TAIL_LEN);
+    ++live_;
+    return true;
+  }
+
+  // Drop the frame of an order that was filled or cancelled
+  bool on_order_closed(std::string_view order_id) {
+    auto it = index_.find(order_id);
+    if (it == index_.end()) return false;
+
+    const uint32_t hole = it->second;
+    index_.erase(it);
+    const uint32_t last = static_cast<uint32_t>(--live_);
+    if (hole != last) {
+      std::memcpy(slot(hole), slot(last), sizes_[last]);
+      sizes_[hole] = sizes_[last];
+      index_.find(this->order_id(hole))->second = hole;
+    }
+    return true;
+  }
+
+  // Patch consecutive request ids into every live frame and return one
+  // iovec per frame, ready for a single gather write. Returns no frames if
+  // an id would be negative, overflow int or not fit ID_WIDTH.
+  std::span<const iovec> panic_cancel(int first_request_id) {
+    const int64_t last_id =
+        int64_t{first_request_id} + static_cast<int64_t>(live_) - 1;
+    if (UNLIKELY(first_request_id < 0 || last_id > INT_MAX)) return {};
+    for (size_t i = 0; i < live_; ++i) {
+      char* frame = slot(i);
+      char id_buf[16];
+      auto [ptr, ec] = std::to_chars(id_buf, id_buf + sizeof(id_buf),
+                                     first_request_id + static_cast<int>(i));
+      const size_t len = static_cast<size_t>(ptr - id_buf);
+      if (UNLIKELY(ec != std::errc() || len > ID_WIDTH)) return {};
+      std::memset(frame + PREFIX_LEN, ' ', ID_WIDTH - len);
+      std::memcpy(frame + PREFIX_LEN + ID_WIDTH - len, id_buf, len);
+      iovecs_[i] = iovec{frame, sizes_[i]};
+    }
+    return std::span<const iovec>(iovecs_.data(), live_);
+  }
+
+  [[nodiscard]] FORCE_INLINE size_t live() const { return live_; }
+
+  [[nodiscard]] FORCE_INLINE std::string_view frame(size_t i) const {
+    return std::string_view(slots_.data() + i * FRAME_SLOT, sizes_[i]);
+  }
+
+ private:
+  static constexpr size_t PREFIX_LEN =
+      std::char_traits<char>::length(CANCEL_PREFIX);
+  static constexpr size_t ORDER_ID_LEN =
+      std::char_traits<char>::length(CANCEL_ORDER_ID);
+  static constexpr size_t TAIL_LEN =
+      std::char_traits<char>::length(CANCEL_TAIL);
+  static constexpr size_t ORDER_ID_OFFSET =
+      PREFIX_LEN + ID_WIDTH + ORDER_ID_LEN;
+
+  FORCE_INLINE char* slot(size_t i) { return slots_.data() + i * FRAME_SLOT; }
+
+  FORCE_INLINE std::string_view order_id(size_t i) const {
+    return std::string_view(slots_.data() + i * FRAME_SLOT + ORDER_ID_OFFSET,
+                            sizes_[i] - ORDER_ID_OFFSET - TAIL_LEN);
+  }
+
+  std::vector<char> slots_;
+  std::vector<uint16_t> sizes_;
+  std::vector<iovec> iovecs_;
+  std::unordered_map<std::string, uint32_t, TransparentStringHash, std::equal_to<>>
+      index_;
+  size_t capacity_;
+  size_t live_;
+};
+
+// Priority lanes of the send scheduler, highest priority first
+enum class Lane : uint8_t { Cancel = 0, Edit = 1, Place = 2 };
+static constexpr size_t LANE_COUNT = 3;
+
+// Lock-free single-producer single-consumer ring of serialized frames.
+// Capacity must be a power of two.
+template <size_t SlotSize, size_t Capacity>
+class SpscFrameRing {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+
+ public:
+  struct ALIGNED(64) Slot {
+    int64_t enqueued_ns;
+    uint32_t size;
+    Lane lane;
+    char data[SlotSize];
+  };
+
+  SpscFrameRing() : slots_(std::make_unique<Slot[]>(Capacity)) {}
+
+  // Producer side
+  FORCE_INLINE bool push(std::string_view frame, Lane lane, int64_t now_ns) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (UNLIKELY(tail - head_cache_ == Capacity)) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == Capacity) return false;
+    }
+    if (UNLIKELY(frame.size() > SlotSize)) return false;
+
+    Slot& slot = slots_[tail & (Capacity - 1)];
+    std::memcpy(slot.data, frame.data(), frame.size());
+    slot.size = static_cast<uint32_t>(frame.size());
+    slot.lane = lane;
+    slot.enqueued_ns = now_ns;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  [[nodiscard]] FORCE_INLINE size_t readable() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] FORCE_INLINE const Slot& peek(size_t i) const {
+    return slots_[(head_.load(std::memory_order_relaxed) + i) &
+                  (Capacity - 1)];
+  }
+
+  FORCE_INLINE void consume(size_t count) {
+    head_.store(head_.load(std::memory_order_relaxed) + count,
+                std::memory_order_release);
+  }
+
+ private:
+  ALIGNED(64) std::atomic<uint64_t> head_{0};
+  ALIGNED(64) std::atomic<uint64_t> tail_{0};
+  uint64_t head_cache_ = 0;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+// Local model of the exchange credit pool: a token bucket refilled at a
+// fixed rate, with a per-lane cost for every request
+struct CreditConfig {
+  double max_credits = 50000.0;
+  double refill_per_sec = 10000.0;
+  std::array<double, LANE_COUNT> cost = {500.0, 500.0, 500.0};
+};
+
+// Sits between serialization and the socket. Producers push frames into
+// separate lock-free lanes; the sending thread drains the highest priority
+// lane first, as far as the credit model allows, and hands each batch to
+// the transport in one gather write. With strict_priority off every frame
+// shares one FIFO lane.
+class SendScheduler {
+ public:
+  static constexpr size_t SLOT_SIZE = 448;
+  static constexpr size_t LANE_CAPACITY = 1024;
+  using Ring = SpscFrameRing<SLOT_SIZE, LANE_CAPACITY>;
+
+  explicit SendScheduler(const CreditConfig& config = CreditConfig(),
+                         size_t max_batch = 64, bool strict_priority = true)
+      : config_(config),
+        credits_(config.max_credits),
+        refill_per_ns_(config.refill_per_sec / 1e9),
+        last_refill_ns_(0),
+        max_batch_(max_batch),
+        strict_priority_(strict_priority) {
+    iovecs_.reserve(max_batch);
+  }
+
+  // Producer side: queue a serialized frame on its lane. Fails, and counts
+  // the frame in rejected(), when the lane is full or the frame is longer
+  // than SLOT_SIZE.
+  [[nodiscard]] FORCE_INLINE bool submit(Lane lane, std::string_view frame,
+                                         int64_t now_ns) {
+    TRACE_INSTANT(Enqueue, frame.size());
+    Lane ring = strict_priority_ ? lane : Lane::Place;
+    if (UNLIKELY(!lanes_[static_cast<size_t>(ring)].push(frame, lane,
+                                                         now_ns))) {
+      ++rejected_;
+      return false;
+    }
+    return true;
+  }
+
+  // Consumer side: send one batch. Returns the number of frames sent, or
+  // -1 if the write failed; the frames then stay queued and their credits
+  // are refunded. Queueing delays are recorded per lane of origin when
+  // latencies is given.
+  ssize_t poll(FdTransport& transport, int64_t now_ns,
+               std::array<LatencyRecorder*, LANE_COUNT> latencies = {}) {
+    refill(now_ns);
+    iovecs_.clear();
+
+    std::array<size_t, LANE_COUNT> taken{};
+    double charged = 0.0;
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+      const Ring& ring = lanes_[lane];
+      const size_t ready = ring.readable();
+      size_t n = 0;
+      while (n < ready && iovecs_.size() < max_batch_) {
+        const auto& slot = ring.peek(n);
+        const double cost = config_.cost[static_cast<size_t>(slot.lane)];
+        if (credits_ - charged < cost) break;
+        charged += cost;
+        iovecs_.push_back(iovec{const_cast<char*>(slot.data), slot.size});
+        ++n;
+      }
+      taken[lane] = n;
+      // Lower lanes never overtake a higher lane that is still waiting
+      if (n < ready) break;
+    }
+
+    if (iovecs_.empty()) return 0;
+    if (UNLIKELY(!transport.send(iovecs_))) return -1;
+
+    credits_ -= charged;
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+      if (taken[lane] == 0) continue;
+      for (size_t i = 0; i < taken[lane]; ++i) {
+        const auto& slot = lanes_[lane].peek(i);
+        if (auto* lat = latencies[static_cast<size_t>(slot.lane)]) {
+          lat->record_ns(now_ns - slot.enqueued_ns);
+        }
+      }
+      lanes_[lane].consume(taken[lane]);
+    }
+    return static_cast<ssize_t>(iovecs_.size());
+  }
+
+  [[nodiscard]] size_t queued() const {
+    size_t total = 0;
+    for (const auto& ring : lanes_) total += ring.readable();
+    return total;
+  }
+
+  [[nodiscard]] FORCE_INLINE double credits() const { return credits_; }
+
+  // Frames submit() turned away, producer side only
+  [[nodiscard]] FORCE_INLINE uint64_t rejected() const { return rejected_; }
+
+ private:
+  FORCE_INLINE void refill(int64_t now_ns) {
+    if (last_refill_ns_ != 0) {
+      credits_ = std::min(config_.max_credits,
+                          credits_ + (now_ns - last_refill_ns_) *
+                                         refill_per_ns_);
+    }
+    last_refill_ns_ = now_ns;
+  }
+
+  std::array<Ring, LANE_COUNT> lanes_;
+  CreditConfig config_;
+  double credits_;
+  double refill_per_ns_;
+  int64_t last_refill_ns_;
+  size_t max_batch_;
+  bool strict_priority_;
+  uint64_t rejected_ = 0;
+  std::vector<iovec> iovecs_;
+};
+
+// Channel name pattern such as "book.{inst}.raw", split around the
+// instrument placeholder
+struct ChannelTemplate {
+  std::string_view prefix;
+  std::string_view suffix;
+
+  static constexpr ChannelTemplate parse(std::string_view pattern) {
+    constexpr std::string_view placeholder = "{inst}";
+    const size_t pos = pattern.find(placeholder);
+    if (pos == std::string_view::npos) return ChannelTemplate{pattern, {}};
+    return ChannelTemplate{pattern.substr(0, pos),
+                           pattern.substr(pos + placeholder.size())};
+  }
+};
+
+namespace deribit {
+namespace channels {
+static constexpr ChannelTemplate BOOK_RAW =
+    ChannelTemplate::parse("book.{inst}.raw");
+static constexpr ChannelTemplate BOOK_100MS =
+    ChannelTemplate::parse("book.{inst}.100ms");
+static constexpr ChannelTemplate TRADES_RAW =
+    ChannelTemplate::parse("trades.{inst}.raw");
+static constexpr ChannelTemplate TRADES_100MS =
+    ChannelTemplate::parse("trades.{inst}.100ms");
+static constexpr ChannelTemplate TICKER_100MS =
+    ChannelTemplate::parse("ticker.{inst}.100ms");
+}  // namespace channels
+}  // namespace deribit
+
+// Builds subscribe frames for large channel lists. Names are composed
+// straight into the output from channel templates and interned instrument
+// names, and a new frame is started whenever the next channel would push
+// the current one past max_frame_size. A channel that could not fit even
+// in a frame of its own is skipped and counted in oversized().
+class ChannelListBuilder {
+ public:
+  static constexpr const char* CHANNELS_OPEN = ",\"params\":{\"channels\":[";
+  static constexpr const char* CHANNELS_CLOSE = "]}}";
+
+  explicit ChannelListBuilder(const InstrumentRegistry* instruments = nullptr,
+                              size_t max_frame_size = 32 * 1024,
+                              const char* method =
+                                  deribit::methods::PUBLIC_SUBSCRIBE)
+      : buffer_(max_frame_size + 256),
+        instruments_(instruments),
+        max_frame_size_(max_frame_size),
+        next_request_id_(0),
+        frame_start_(0),
+        channels_in_frame_(0),
+        open_(false) {
+    header_ = "{\"jsonrpc\":\"2.0\",\"method\":\"";
+    header_ += method;
+    header_ += "\",\"id\":";
+    // Longest frame a single channel can need around its name
+    frame_overhead_ = header_.size() + MAX_ID_CHARS +
+                      std::char_traits<char>::length(CHANNELS_OPEN) +
+                      CLOSE_LEN;
+  }
+
+  // Start a new list; frames get consecutive ids from first_request_id
+  void begin(int first_request_id) {
+    reset();
+    client_ = nullptr;
+    next_request_id_ = first_request_id;
+  }
+
+  // Start a new list; each frame claims its id from client as it opens
+  void begin(DeribitClient& client) {
+    reset();
+    client_ = &client;
+  }
+
+  FORCE_INLINE void add(std::string_view channel) {
+    add_parts(channel, {}, {});
+  }
+
+  // The template overloads need the registry passed at construction
+  FORCE_INLINE void add(const ChannelTemplate& tmpl, InstrumentId instrument) {
+    assert(instruments_ && "no instrument registry");
+    add_parts(tmpl.prefix, instruments_->name(instrument), tmpl.suffix);
+  }
+
+  // Every template for every instrument
+  void add(std::span<const ChannelTemplate> templates,
+           std::span<const InstrumentId> instruments) {
+    assert(instruments_ && "no instrument registry");
+    for (InstrumentId instrument : instruments) {
+      const std::string_view name = instruments_->name(instrument);
+      for (const ChannelTemplate& tmpl : templates) {
+        add_parts(tmpl.prefix, name, tmpl.suffix);
+      }
+    }
+  }
+
+  // Close the last frame and return one iovec per frame
+  std::span<const iovec> finish() {
+    if (open_) close_frame();
+    iovecs_.clear();
+    for (const FrameRef& ref : frames_) {
+      iovecs_.push_back(
+          iovec{const_cast<char*>(buffer_.data()) + ref.offset, ref.size});
+    }
+    return iovecs_;
+  }
+
+  [[nodiscard]] FORCE_INLINE size_t frame_count() const {
+    return frames_.size();
+  }
+
+  [[nodiscard]] FORCE_INLINE std::string_view frame(size_t i) const {
+    return std::string_view(buffer_.data() + frames_[i].offset,
+                            frames_[i].size);
+  }
+
+  // Next id of a list started from a fixed first id
+  [[nodiscard]] FORCE_INLINE int next_request_id() const {
+    return next_request_id_;
+  }
+
+  // Channels skipped since begin() for being too long for any frame
+  [[nodiscard]] FORCE_INLINE size_t oversized() const { return oversized_; }
+
+ private:
+  static constexpr size_t CLOSE_LEN =
+      std::char_traits<char>::length(CHANNELS_CLOSE);
+  static constexpr size_t MAX_ID_CHARS = 11;  // "-2147483648"
+
+  void reset() {
+    buffer_.reset();
+    frames_.clear();
+    iovecs_.clear();
+    oversized_ = 0;
+    open_ = false;
+  }
+
+  FORCE_INLINE void add_parts(std::string_view a, std::string_view b,
+                              std::string_view c) {
+    const size_t len = a.size() + b.size() + c.size() + 3;  // quotes, comma
+    if (UNLIKELY(len + frame_overhead_ > max_frame_size_)) {
+      ++oversized_;
+      return;
+    }
+    if (!open_) {
+      open_frame();
+    } else if (channels_in_frame_ > 0 &&
+               buffer_.size() - frame_start_ + len + CLOSE_LEN >
+                   max_frame_size_) {
+      close_frame();
+      open_frame();
+    }
+
+    if (channels_in_frame_ > 0) buffer_.append(',');
+    buffer_.append('"');
+    buffer_.append(a);
+    buffer_.append(b);
+    buffer_.append(c);
+    buffer_.append('"');
+    ++channels_in_frame_;
+  }
+
+  void open_frame() {
+    frame_start_ = buffer_.size();
+    buffer_.append(header_);
+    const int id =
+        client_ ? client_->reserve_request_ids(1) : next_request_id_++;
+    char id_buf[16];
+    auto [ptr, ec] = std::to_chars(id_buf, id_buf + sizeof(id_buf), id);
+    buffer_.append(id_buf, ptr - id_buf);
+    buffer_.append(CHANNELS_OPEN);
+    channels_in_frame_ = 0;
+    open_ = true;
+  }
+
+  void close_frame() {
+    buffer_.append(CHANNELS_CLOSE, CLOSE_LEN);
+    frames_.push_back(
+        FrameRef{static_cast<uint32_t>(frame_start_),
+                 static_cast<uint32_t>(buffer_.size() - frame_start_)});
+    open_ = false;
+  }
+
+  Buffer buffer_;
+  const InstrumentRegistry* instruments_;
+  DeribitClient* client_ = nullptr;
+  std::string header_;
+  size_t max_frame_size_;
+  size_t frame_overhead_;
+  int next_request_id_;
+  size_t oversized_ = 0;
+  size_t frame_start_;
+  size_t channels_in_frame_;
+  bool open_;
+  std::vector<FrameRef> frames_;
+  std::vector<iovec> iovecs_;
+};
+
+// The whole reconnect sequence (auth, heartbeat, cancel on disconnect and
+// subscriptions) rendered ahead of time, so after a reconnect it only has
+// to be sent as one pipelined burst. Subscription changes are collected and
+// the bundle is re-rendered once by the next refresh(), which belongs off
+// the reconnect path; the accessors show the bundle as of the last
+// refresh(). Subscriptions are split into frames
+// of at most max_frame_size bytes. Setup requests use their own id range
+// so responses can be told apart from regular traffic.
+class SessionSetupBundle {
+ public:
+  static constexpr int FIRST_REQUEST_ID = 1000000000;
+
+  explicit SessionSetupBundle(AuthCredentials credentials,
+                              int heartbeat_interval_seconds = 30,
+                              size_t max_frame_size = 32 * 1024)
+      : buffer_(4096),
+        credentials_(std::move(credentials)),
+        heartbeat_interval_(heartbeat_interval_seconds),
+        subscriptions_(nullptr, max_frame_size),
+        stale_(false) {
+    render();
+  }
+
+  void add_subscription(std::string_view channel) {
+    if (!subscribed_.emplace(channel, channels_.size()).second) return;
+    channels_.emplace_back(channel);
+    stale_ = true;
+  }
+
+  // Swap-removes the channel, so the subscription order is not kept
+  void remove_subscription(std::string_view channel) {
+    auto found = subscribed_.find(channel);
+    if (found == subscribed_.end()) return;
+    const size_t index = found->second;
+    subscribed_.erase(found);
+    if (index != channels_.size() - 1) {
+      channels_[index] = std::move(channels_.back());
+      subscribed_.find(channels_[index])->second = index;
+    }
+    channels_.pop_back();
+    stale_ = true;
+  }
+
+  // Render any pending subscription changes
+  void refresh() {
+    if (!stale_) return;
+    render();
+    stale_ = false;
+  }
+
+  // The whole bundle as of the last refresh()
+  [[nodiscard]] FORCE_INLINE std::span<const iovec> finish() const {
+    return iovecs_;
+  }
+
+  // One iovec per request, ready for a single gather write
+  [[nodiscard]] FORCE_INLINE std::span<const iovec> iovecs() const {
+    return iovecs_;
+  }
+
+  [[nodiscard]] FORCE_INLINE size_t frame_count() const {
+    return iovecs_.size();
+  }
+
+  [[nodiscard]] FORCE_INLINE std::string_view frame(size_t i) const {
+    return std::string_view(static_cast<const char*>(iovecs_[i].iov_base),
+                            iovecs_[i].iov_len);
+  }
+
+  [[nodiscard]] FORCE_INLINE std::span<const std::string> channels() const {
+    return channels_;
+  }
+
+ private:
+  template <typename WriteFn>
+  void add_frame(WriteFn&& write) {
+    const size_t start = buffer_.size();
+    DeribitJsonRpc<Buffer> rpc(buffer_);
+    write(rpc, FIRST_REQUEST_ID + static_cast<int>(frames_.size()));
+    frames_.push_back(FrameRef{static_cast<uint32_t>(start),
+                               static_cast<uint32_t>(buffer_.size() - start)});
+  }
+
+  void render() {
+    buffer_.reset();
+    frames_.clear();
+
+    add_frame([&](auto& rpc, int id) {
+      write_auth_request(rpc, id, credentials_);
+    });
+    add_frame([&](auto& rpc, int id) {
+      write_set_heartbeat_request(rpc, id, heartbeat_interval_);
+    });
+    add_frame([&](auto& rpc, int id) {
+      write_enable_cancel_on_disconnect_request(rpc, id);
+    });
+
+    subscriptions_.begin(FIRST_REQUEST_ID + static_cast<int>(frames_.size()));
+    for (const auto& channel : channels_) {
+      subscriptions_.add(channel);
+    }
+    std::span<const iovec> subscribe_frames = subscriptions_.finish();
+
+    // Offsets are only final once the buffer stops growing
+    iovecs_.clear();
+    for (const FrameRef& ref : frames_) {
+      iovecs_.push_back(
+          iovec{const_cast<char*>(buffer_.data()) + ref.offset, ref.size});
+    }
+    iovecs_.insert(iovecs_.end(), subscribe_frames.begin(),
+                   subscribe_frames.end());
+  }
+
+  Buffer buffer_;
+  AuthCredentials credentials_;
+  int heartbeat_interval_;
+  ChannelListBuilder subscriptions_;
+  std::vector<std::string> channels_;
+  // Channel name to its index in channels_
+  std::unordered_map<std::string, size_t, TransparentStringHash,
+                     std::equal_to<>>
+      subscribed_;
+  bool stale_;
+  std::vector<FrameRef> frames_;
+  std::vector<iovec> iovecs_;
+};
+
+}  // namespace v3
@@ -1,406 +1,22 @@
 #include <benchmark/benchmark.h>
+#include <unistd.h>
 
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
-#include <chrono>
 #include <string>
 #include <string_view>
 #include <vector>
-// #include <algorithm>
-
-using RequestID = std::uint64_t;
-using ClientOrderID = std::uint64_t;
-using sv = std::string_view;
-
-constexpr int METHOD_PLACE_SIZE = 12;
-constexpr int ACCESS_TKN_SIZE = 400;
-constexpr int INSTRUMENT_SIZE = 35;
-constexpr int TIF_SIZE = 19;
-
-#define FORCE_INLINE __attribute__((always_inline)) inline
-
-template <size_t Capacity>
-class alignas(64) StaticBuffer {
- public:
-  StaticBuffer() : size_(0) {}
-
-  FORCE_INLINE void clear() { size_ = 0; }
-
-  [[nodiscard]] FORCE_INLINE const char* data() const { return data_; }
-  [[nodiscard]] FORCE_INLINE char* data() { return data_; }
-  [[nodiscard]] FORCE_INLINE size_t size() const { return size_; }
-  [[nodiscard]] FORCE_INLINE sv view() const { return {data_, size_}; }
-
-  FORCE_INLINE void set_size(size_t new_size) {
-    if (new_size <= Capacity) {
-      size_ = new_size;
-    }
-  }
-
- private:
-  alignas(64) char data_[Capacity];
-  size_t size_;
-};
-
-struct jsonrpc_t {
-  constexpr static const char* name = "jsonrpc";
-};
-struct method_t {
-  constexpr static const char* name = "method";
-};
-struct request_id_t {
-  constexpr static const char* name = "id";
-};
-struct params_t {
-  constexpr static const char* name = "params";
-};
-struct access_token_t {
-  constexpr static const char* name = "access_token";
-};
-struct instrument_t {
-  constexpr static const char* name = "instrument_name";
-};
-struct amount_t {
-  constexpr static const char* name = "amount";
-};
-struct label_t {
-  constexpr static const char* name = "label";
-};
-struct price_t {
-  constexpr static const char* name = "price";
-};
-struct post_only_t {
-  constexpr static const char* name = "post_only";
-};
-struct reject_post_only_t {
-  constexpr static const char* name = "reject_post_only";
-};
-struct reduce_only_t {
-  constexpr static const char* name = "reduce_only";
-};
-struct time_in_force_t {
-  constexpr static const char* name = "time_in_force";
-};
-struct order_id_t {
-  constexpr static const char* name = "order_id";
-};
-
-namespace schema {
-template <size_t N>
-struct string {
-  using type = sv;
-  static constexpr size_t max_size = N;
-};
-
-template <typename T>
-struct number {
-  using type = T;
-};
-
-struct boolean {
-  using type = bool;
-};
-
-template <typename Key>
-struct fixed_key_value {
-  using key_type = Key;
-};
-
-template <typename Key, typename ValueType>
-struct key_value {
-  using key_type = Key;
-  using value_type = ValueType;
-};
-
-template <typename... Fields>
-struct object {};
-}  // namespace schema
-
-template <typename T>
-FORCE_INLINE int int_to_str(char* buffer, T value) {
-  if (value == 0) {
-    buffer[0] = '0';
-    return 1;
-  }
-
-  bool negative = false;
-  if (value < 0) {
-    negative = true;
-    value = -value;
-  }
-
-  char temp[32];
-  int i = 0;
-  while (value > 0) {
-    temp[i++] = '0' + (value % 10);
-    value /= 10;
-  }
-
-  int result_len = i + (negative ? 1 : 0);
-  if (negative) {
-    buffer[0] = '-';
-  }
-
-  for (int j = 0; j < i; j++) {
-    buffer[(negative ? 1 : 0) + j] = temp[i - j - 1];
-  }
-
-  return result_len;
-}
-
-FORCE_INLINE int double_to_str(char* buffer, double value) {
-  int64_t int_part = static_cast<int64_t>(value);
-  int len = int_to_str(buffer, int_part);
-
-  double frac_part = value - int_part;
-  if (frac_part > 0.0001 || frac_part < -0.0001) {
-    buffer[len++] = '.';
-
-    int64_t frac_digit = static_cast<int64_t>(frac_part * 10);
-    buffer[len++] = '0' + (frac_digit % 10);
-  }
-  return len;
-}
-
-using place_schema = schema::object<
-    schema::fixed_key_value<jsonrpc_t>,
-    schema::key_value<method_t, schema::string<METHOD_PLACE_SIZE>>,
-    schema::key_value<request_id_t, schema::number<RequestID>>,
-    schema::key_value<
-        params_t,
-        schema::object<
-            schema::key_value<access_token_t, schema::string<ACCESS_TKN_SIZE>>,
-            schema::key_value<instrument_t, schema::string<INSTRUMENT_SIZE>>,
-            schema::key_value<amount_t, schema::number<double>>,
-            schema::key_value<label_t, schema::number<ClientOrderID>>,
-            schema::key_value<price_t, schema::number<double>>,
-            schema::key_value<post_only_t, schema::boolean>,
-            schema::key_value<reject_post_only_t, schema::boolean>,
-            schema::key_value<reduce_only_t, schema::boolean>,
-            schema::key_value<time_in_force_t, schema::string<TIF_SIZE>>>>>;
-
-using cancel_schema = schema::object<
-    schema::fixed_key_value<jsonrpc_t>,
-    schema::key_value<method_t, schema::string<METHOD_PLACE_SIZE>>,
-    schema::key_value<request_id_t, schema::number<RequestID>>,
-    schema::key_value<
-        params_t,
-        schema::object<
-            schema::key_value<access_token_t, schema::string<ACCESS_TKN_SIZE>>,
-            schema::key_value<order_id_t, schema::string<METHOD_PLACE_SIZE>>>>>;
-
-using edit_schema = schema::object<
-    schema::fixed_key_value<jsonrpc_t>,
-    schema::key_value<method_t, schema::string<METHOD_PLACE_SIZE>>,
-    schema::key_value<request_id_t, schema::number<RequestID>>,
-    schema::key_value<
-        params_t,
-        schema::object<
-            schema::key_value<access_token_t, schema::string<ACCESS_TKN_SIZE>>,
-            schema::key_value<order_id_t, schema::string<METHOD_PLACE_SIZE>>,
-            schema::key_value<amount_t, schema::number<double>>,
-            schema::key_value<price_t, schema::number<double>>,
-            schema::key_value<post_only_t, schema::boolean>,
-            schema::key_value<reduce_only_t, schema::boolean>>>>;
-
-template <typename Schema>
-class Writer {
- public:
-  explicit Writer(char* buffer, size_t& size)
-      : buffer_(buffer),
-        size_(size),
-        wrote_jsonrpc_(false),
-        wrote_method_(false),
-        wrote_id_(false),
-        started_params_(false),
-        first_param_(true) {
-    buffer_[size_++] = '{';
-  }
-
-  template <typename Tag, typename T>
-  FORCE_INLINE void set(const T& value) {
-    if constexpr (std::is_same_v<Tag, jsonrpc_t>) {
-      write_kv("jsonrpc", "2.0", true);
-      wrote_jsonrpc_ = true;
-    } else if constexpr (std::is_same_v<Tag, method_t>) {
-      write_kv("method", value, !wrote_jsonrpc_);
-      wrote_method_ = true;
-    } else if constexpr (std::is_same_v<Tag, request_id_t>) {
-      write_kv("id", value, !wrote_jsonrpc_ && !wrote_method_);
-      wrote_id_ = true;
-    }
-  }
-
-  template <typename ParentTag, typename ChildTag, typename T>
-  FORCE_INLINE void set(const T& value) {
-    if constexpr (std::is_same_v<ParentTag, params_t>) {
-      if (!started_params_) start_params();
-      write_field(ChildTag::name, value, first_param_);
-      first_param_ = false;
-    }
-  }
-
-  FORCE_INLINE size_t finalize() {
-    if (started_params_) {
-      buffer_[size_++] = '}';
-    }
-    buffer_[size_++] = '}';
-    return size_;
-  }
-
-  template <typename SchemaType>
-  FORCE_INLINE void set_fixed_values() {
-    set<jsonrpc_t>("2.0");
-  }
-
- private:
-  FORCE_INLINE void start_params() {
-    add_comma_if_needed();
-    write_key("params");
-    buffer_[size_++] = '{';
-    started_params_ = true;
-    first_param_ = true;
-  }
-
-  template <typename T>
-  FORCE_INLINE void write_kv(const char* key, const T& value, bool first) {
-    add_comma_if_needed(!first);
-    write_key(key);
-    write_value(value);
-  }
-
-  FORCE_INLINE void write_key(const char* key) {
-    buffer_[size_++] = '"';
-    size_t key_len = strlen(key);
-    std::memcpy(buffer_ + size_, key, key_len);
-    size_ += key_len;
-    buffer_[size_++] = '"';
-    buffer_[size_++] = ':';
-  }
-
-  FORCE_INLINE void add_comma_if_needed(bool needed = true) {
-    if (size_ <= 1) return;
-    if (buffer_[size_ - 1] == '{' || buffer_[size_ - 1] == '[') return;
-    if (needed) buffer_[size_++] = ',';
-  }
-
-  template <typename T>
-  FORCE_INLINE void write_field(const char* name, const T& value, bool first) {
-    add_comma_if_needed(!first);
-    write_key(name);
-    write_value(value);
-  }
-
-  FORCE_INLINE void write_value(const sv& value) {
-    buffer_[size_++] = '"';
-    std::memcpy(buffer_ + size_, value.data(), value.size());
-    size_ += value.size();
-    buffer_[size_++] = '"';
-  }
-
-  FORCE_INLINE void write_value(const char* value) { write_value(sv(value)); }
-
-  FORCE_INLINE void write_value(const std::string& value) {
-    write_value(sv(value));
-  }
-
-  FORCE_INLINE void write_value(int value) {
-    char temp[32];
-    int len = int_to_str(temp, value);
-    std::memcpy(buffer_ + size_, temp, len);
-    size_ += len;
-  }
-
-  FORCE_INLINE void write_value(uint64_t value) {
-    char temp[32];
-    int len = int_to_str(temp, value);
-    std::memcpy(buffer_ + size_, temp, len);
-    size_ += len;
-  }
-
-  FORCE_INLINE void write_value(double value) {
-    char temp[32];
-    int len = double_to_str(temp, value);
-    std::memcpy(buffer_ + size_, temp, len);
-    size_ += len;
-  }
-
-  FORCE_INLINE void write_value(bool value) {
-    const char* str = value ? "true" : "false";
-    size_t len = value ? 4 : 5;
-    std::memcpy(buffer_ + size_, str, len);
-    size_ += len;
-  }
-
-  char* buffer_;
-  size_t& size_;
-  bool wrote_jsonrpc_;
-  bool wrote_method_;
-  bool wrote_id_;
-  bool started_params_;
-  bool first_param_;
-};
-
-template <typename Schema, typename BufferType>
-struct WriteImpl {
-  static FORCE_INLINE sv write(BufferType& buffer, auto&& callback) {
-    buffer.clear();
-    size_t size = 0;
-
-    Writer<Schema> writer(buffer.data(), size);
-    writer.template set_fixed_values<Schema>();
-    callback(writer);
-    size = writer.finalize();
-    buffer.set_size(size);
-
-    return buffer.view();
-  }
-};
-
-template <typename BufferType>
-class Serializer {
- public:
-  explicit Serializer(BufferType& buffer) : buffer_(buffer) {}
-
-  template <typename Schema, typename Callback>
-  FORCE_INLINE sv write(Callback&& callback) {
-    return WriteImpl<Schema, BufferType>::write(
-        buffer_, std::forward<Callback>(callback));
-  }
 
- private:
-  BufferType& buffer_;
-};
+#include "common/alloc_counter.h"
+#include "common/latency_recorder.h"
+#include "common/perf_counters.h"
+#include "common/results.h"
+#include "v4.h"
 
-// class LatencyMeasurer {
-// public:
-//   void record(std::chrono::nanoseconds latency) {
-//     measurements_.push_back(latency.count());
-//   }
-//
-//   void report() const {
-//     if (measurements_.empty()) return;
-//
-//     std::vector<int64_t> sorted_measurements = measurements_;
-//     std::sort(sorted_measurements.begin(), sorted_measurements.end());
-//
-//     size_t count = sorted_measurements.size();
-//     auto median = sorted_measurements[count / 2];
-//     auto percentile_0_9 = sorted_measurements[count * 9 / 100];
-//     auto percentile_99 = sorted_measurements[count * 99 / 100];
-//     auto percentile_99_9 = sorted_measurements[count * 999 / 1000];
-//
-//     std::cout << "Latency (ns):\n"
-//               << "  Median: " << median << "\n"
-//               << "  0.9th Percentile: " << percentile_0_9 << "\n"
-//               << "  99th percentile: " << percentile_99 << "\n"
-//               << "  99.9th percentile: " << percentile_99_9 << "\n";
-//   }
-//
-// private:
-//   std::vector<int64_t> measurements_;
-// };
+using namespace v4;
 
 void debug_print_json(sv json) {
   std::cout << "JSON size: " << json.size() << " bytes" << std::endl;
@@ -488,6 +104,26 @@ void verify_json_serialization() {
 
   std::cout << edit_json << std::endl;
   debug_print_json(edit_json);
+
+  std::cout << "\n======== FAN-OUT CANCEL TEST ========\n";
+
+  FanOut fan_out(buffer);
+  fan_out.write<cancel_schema>([&](auto& w) {
+    w.template set<method_t>(cancel_endpoint);
+    w.template set<request_id_t>(request_id);
+    w.template set<params_t, access_token_t>(access_token);
+    w.template set<params_t, order_id_t>(order_id);
+  });
+
+  std::string backup_token = "backupsessiontoken";
+  SessionCredentials sessions[] = {{request_id, access_token},
+                                   {request_id + 1, backup_token}};
+  for (size_t i = 0; i < 2; ++i) {
+    for (const iovec& part : fan_out.overlay(i, sessions[i])) {
+      std::cout << sv(static_cast<const char*>(part.iov_base), part.iov_len);
+    }
+    std::cout << std::endl;
+  }
 }
 //
 // void verify_json_dynamic_length() {
@@ -599,7 +235,6 @@ void verify_json_serialization() {
 static void BM_PlaceOrderSerialization(benchmark::State& state) {
   StaticBuffer<4096> buffer;
   Serializer serializer(buffer);
-  // LatencyMeasurer latency_measurer;
 
   std::string endpoint = "private/buy";
   uint64_t request_id = 17;
@@ -607,9 +242,9 @@ static void BM_PlaceOrderSerialization(benchmark::State& state) {
   std::string ticker = "BTC-PERPETUAL";
   std::string time_in_force = "immediate_or_cancel";
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
-    // auto start = std::chrono::high_resolution_clock::now();
-
     serializer.write<place_schema>([&](auto& w) {
       w.template set<method_t>(endpoint);
       w.template set<request_id_t>(request_id);
@@ -624,13 +259,86 @@ static void BM_PlaceOrderSerialization(benchmark::State& state) {
       w.template set<params_t, time_in_force_t>(time_in_force);
     });
 
-    // auto end = std::chrono::high_resolution_clock::now();
-    // latency_measurer.record(end - start);
+    benchmark::DoNotOptimize(buffer.data());
+    benchmark::DoNotOptimize(buffer);
+  }
+}
+
+// BM_PlaceOrderSerialization with runtime statistics on; the difference is
+// the per-message cost of counting
+static void BM_PlaceOrderSerializationStats(benchmark::State& state) {
+  StaticBuffer<4096> buffer;
+  Serializer serializer(buffer,
+                        ThreadStats{&runtime_stats::register_thread("main")});
+
+  std::string endpoint = "private/buy";
+  uint64_t request_id = 17;
+  std::string access_token = "thisismyreallylongaccesstokenstoredontheheap";
+  std::string ticker = "BTC-PERPETUAL";
+  std::string time_in_force = "immediate_or_cancel";
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    serializer.write<place_schema>([&](auto& w) {
+      w.template set<method_t>(endpoint);
+      w.template set<request_id_t>(request_id);
+      w.template set<params_t, access_token_t>(access_token);
+      w.template set<params_t, instrument_t>(ticker);
+      w.template set<params_t, amount_t>(100.0);
+      w.template set<params_t, label_t>(23);
+      w.template set<params_t, price_t>(99993.0);
+      w.template set<params_t, post_only_t>(true);
+      w.template set<params_t, reject_post_only_t>(false);
+      w.template set<params_t, reduce_only_t>(false);
+      w.template set<params_t, time_in_force_t>(time_in_force);
+    });
 
     benchmark::DoNotOptimize(buffer.data());
     benchmark::DoNotOptimize(buffer);
   }
-  // latency_measurer.report();
+}
+
+static void BM_PlaceOrderLatencyPercentiles(benchmark::State& state) {
+  const int iterations = 10000;
+  StaticBuffer<4096> buffer;
+  Serializer serializer(buffer);
+  LatencyRecorder recorder;
+
+  std::string endpoint = "private/buy";
+  uint64_t request_id = 17;
+  std::string access_token = "thisismyreallylongaccesstokenstoredontheheap";
+  std::string ticker = "BTC-PERPETUAL";
+  std::string time_in_force = "immediate_or_cancel";
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    for (int i = 0; i < iterations; ++i) {
+      const uint64_t start = recorder.start();
+
+      serializer.write<place_schema>([&](auto& w) {
+        w.template set<method_t>(endpoint);
+        w.template set<request_id_t>(request_id);
+        w.template set<params_t, access_token_t>(access_token);
+        w.template set<params_t, instrument_t>(ticker);
+        w.template set<params_t, amount_t>(100.0);
+        w.template set<params_t, label_t>(23);
+        w.template set<params_t, price_t>(99993.0);
+        w.template set<params_t, post_only_t>(true);
+        w.template set<params_t, reject_post_only_t>(false);
+        w.template set<params_t, reduce_only_t>(false);
+        w.template set<params_t, time_in_force_t>(time_in_force);
+      });
+
+      recorder.stop(start);
+      benchmark::DoNotOptimize(buffer.data());
+    }
+  }
+  allocs.stop();
+  perf.stop();
+
+  recorder.report_to(state);
 }
 
 static void BM_CancelOrderSerialization(benchmark::State& state) {
@@ -642,6 +350,8 @@ static void BM_CancelOrderSerialization(benchmark::State& state) {
   std::string access_token = "thisismyreallylongaccesstokenstoredontheheap";
   std::string order_id = "ETH-349223";
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     serializer.write<cancel_schema>([&](auto& w) {
       w.template set<method_t>(endpoint);
@@ -661,6 +371,8 @@ static void BM_EditOrderSerialization(benchmark::State& state) {
   std::string access_token = "thisismyreallylongaccesstokenstoredontheheap";
   std::string order_id = "BTC-781456";
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     StaticBuffer<4096> buffer;
     Serializer serializer(buffer);
@@ -687,6 +399,8 @@ static void BM_StringLengthImpact(benchmark::State& state) {
   std::string ticker = "BTC-PERPETUAL";
   std::string time_in_force = "immediate_or_cancel";
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     StaticBuffer<8192> buffer;
     Serializer serializer(buffer);
@@ -707,6 +421,8 @@ static void BM_StringLengthImpact(benchmark::State& state) {
 
     benchmark::DoNotOptimize(json);
   }
+  allocs.stop();
+  perf.stop();
 
   state.SetItemsProcessed(state.iterations() * state.range(0));
   state.SetLabel(std::to_string(state.range(0)) + " chars");
@@ -728,6 +444,8 @@ static void BM_NumericPrecisionImpact(benchmark::State& state) {
   std::string endpoint = "private/buy";
   std::string ticker = "BTC-PERPETUAL";
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     StaticBuffer<4096> buffer;
     Serializer serializer(buffer);
@@ -747,6 +465,8 @@ static void BM_NumericPrecisionImpact(benchmark::State& state) {
 
     benchmark::DoNotOptimize(json);
   }
+  allocs.stop();
+  perf.stop();
 
   state.SetLabel(std::to_string(precision) + " decimal places");
 }
@@ -761,6 +481,8 @@ static void BM_BufferReuse(benchmark::State& state) {
   std::string ticker = "BTC-PERPETUAL";
   std::string time_in_force = "immediate_or_cancel";
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     buffer.clear();
 
@@ -789,6 +511,8 @@ static void BM_BufferRecreate(benchmark::State& state) {
   std::string ticker = "BTC-PERPETUAL";
   std::string time_in_force = "immediate_or_cancel";
 
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
   for (auto _ : state) {
     StaticBuffer<4096> buffer;
     Serializer serializer(buffer);
@@ -827,6 +551,8 @@ static void BM_BatchOrders(benchmark::State& state) {
   StaticBuffer<65536> buffer;
   Serializer serializer(buffer);
 
+  PerfScope perf(state);
+  AllocScope allocs(state);
   for (auto _ : state) {
     std::vector<sv> results;
     results.reserve(batch_size);
@@ -851,12 +577,167 @@ static void BM_BatchOrders(benchmark::State& state) {
       benchmark::DoNotOptimize(json);
     }
   }
+  allocs.stop();
+  perf.stop();
 
   state.SetItemsProcessed(state.iterations() * batch_size);
   state.SetLabel(std::to_string(batch_size) + " orders");
 }
 
+static std::vector<std::string> session_tokens(size_t count) {
+  std::vector<std::string> tokens;
+  for (size_t i = 0; i < count; ++i) {
+    tokens.push_back("thisismyreallylongaccesstokenstoredontheheap" +
+                     std::to_string(i));
+  }
+  return tokens;
+}
+
+static void BM_FanOutReserialize(benchmark::State& state) {
+  const size_t sessions = state.range(0);
+  std::vector<StaticBuffer<4096>> buffers(sessions);
+
+  std::string endpoint = "private/cancel";
+  std::string order_id = "ETH-349223";
+  std::vector<std::string> tokens = session_tokens(sessions);
+  uint64_t request_id = 17;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    ++request_id;
+    for (size_t i = 0; i < sessions; ++i) {
+      Serializer serializer(buffers[i]);
+      auto json = serializer.write<cancel_schema>([&](auto& w) {
+        w.template set<method_t>(endpoint);
+        w.template set<request_id_t>(request_id + i);
+        w.template set<params_t, access_token_t>(tokens[i]);
+        w.template set<params_t, order_id_t>(order_id);
+      });
+      benchmark::DoNotOptimize(json);
+    }
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.SetLabel(std::to_string(sessions) + " sessions");
+}
+
+static void BM_FanOutOverlay(benchmark::State& state) {
+  const size_t sessions = state.range(0);
+  StaticBuffer<4096> buffer;
+  FanOut fan_out(buffer);
+
+  std::string endpoint = "private/cancel";
+  std::string order_id = "ETH-349223";
+  std::vector<std::string> tokens = session_tokens(sessions);
+  uint64_t request_id = 17;
+
+  PerfScope perf(state);
+  AllocScope allocs(state, AllocPolicy::HotPath);
+  for (auto _ : state) {
+    ++request_id;
+    fan_out.write<cancel_schema>([&](auto& w) {
+      w.template set<method_t>(endpoint);
+      w.template set<request_id_t>(request_id);
+      w.template set<params_t, access_token_t>(tokens[0]);
+      w.template set<params_t, order_id_t>(order_id);
+    });
+    for (size_t i = 0; i < sessions; ++i) {
+      auto parts = fan_out.overlay(i, {request_id + i, tokens[i]});
+      benchmark::DoNotOptimize(parts.data());
+    }
+  }
+  allocs.stop();
+  perf.stop();
+
+  state.SetLabel(std::to_string(sessions) + " sessions");
+}
+
+// Strategy work between orders: walks a buffer twice the L2 size in 64 KiB
+// steps, polling the warmer (when on) after every step like an idle loop
+// would. The order goes through write_out_of_line, the same code the
+// warmer runs. Counters cover only the order write; the idle loop is
+// paused out, and the resume syscall lands in both arms alike.
+static void BM_FirstOrderAfterIdle(benchmark::State& state) {
+  const bool warmer_on = state.range(0) != 0;
+  const uint64_t idle_ns = 1'000'000;
+  constexpr size_t step = 64 * 1024;
+  const long l2 = ::sysconf(_SC_LEVEL2_CACHE_SIZE);
+  const size_t strategy_size = l2 > 0 ? 2 * static_cast<size_t>(l2) : 4 << 20;
+  CacheWarmer<TscClock>::Buffer buffer;
+  std::vector<uint8_t> strategy((strategy_size + step - 1) / step * step);
+
+  std::string endpoint = "private/buy";
+  uint64_t request_id = 17;
+  std::string access_token = "thisismyreallylongaccesstokenstoredontheheap";
+  std::string ticker = "BTC-PERPETUAL";
+  std::string time_in_force = "immediate_or_cancel";
+  auto fill = [&](auto& w) {
+    w.template set<method_t>(endpoint);
+    w.template set<request_id_t>(request_id);
+    w.template set<params_t, access_token_t>(access_token);
+    w.template set<params_t, instrument_t>(ticker);
+    w.template set<params_t, amount_t>(100.0);
+    w.template set<params_t, label_t>(23);
+    w.template set<params_t, price_t>(99993.0);
+    w.template set<params_t, post_only_t>(true);
+    w.template set<params_t, reject_post_only_t>(false);
+    w.template set<params_t, reduce_only_t>(false);
+    w.template set<params_t, time_in_force_t>(time_in_force);
+  };
+
+  CacheWarmer<TscClock> warmer(state.range(1) * 1000);
+  warmer.add<place_schema>(fill);
+  warmer.touch(buffer.data(), 512);
+  warmer.touch(access_token.data(), access_token.size());
+  LatencyRecorder latency;
+  size_t offset = 0;
+
+  warmer.reset_stats();
+  PerfScope perf(state);
+  AllocScope allocs(state);
+  for (auto _ : state) {
+    perf.pause();
+    allocs.pause();
+    const uint64_t idle_until = TscClock::now_ns() + idle_ns;
+    while (TscClock::now_ns() < idle_until) {
+      for (size_t end = offset + step; offset < end; offset += 64) {
+        strategy[offset] += 1;
+      }
+      if (offset >= strategy.size()) offset = 0;
+      if (warmer_on) warmer.poll();
+    }
+    allocs.resume();
+    perf.resume();
+
+    ++request_id;
+    const uint64_t t0 = latency.start();
+    auto json = write_out_of_line<place_schema>(buffer, fill);
+    benchmark::DoNotOptimize(json.data());
+    const uint64_t t1 = TscClock::stop();
+    const uint64_t ns = TscClock::calibration().to_ns(t1 - t0);
+    latency.record_ns(static_cast<int64_t>(ns));
+    state.SetIterationTime(static_cast<double>(ns) / 1e9);
+  }
+  allocs.stop();
+  perf.stop();
+
+  latency.report_to(state);
+  const WarmerStats& stats = warmer.stats();
+  state.counters["warm_runs"] = benchmark::Counter(
+      static_cast<double>(stats.runs), benchmark::Counter::kAvgIterations);
+  state.counters["warm_ns"] =
+      stats.runs ? static_cast<double>(stats.busy_ns) / stats.runs : 0.0;
+  state.counters["duty_pct"] = 100.0 * stats.duty_cycle(TscClock::now_ns());
+  state.SetLabel(warmer_on ? "warmer every " + std::to_string(state.range(1)) +
+                                 "us"
+                           : "no warmer");
+}
+
 BENCHMARK(BM_PlaceOrderSerialization);
+BENCHMARK(BM_PlaceOrderSerializationStats);
+BENCHMARK(BM_PlaceOrderLatencyPercentiles)->Iterations(3);
 BENCHMARK(BM_CancelOrderSerialization);
 BENCHMARK(BM_EditOrderSerialization);
 BENCHMARK(BM_StringLengthImpact)->Range(8, 1 << 12);
@@ -864,11 +745,21 @@ BENCHMARK(BM_NumericPrecisionImpact)->DenseRange(0, 9, 1);
 BENCHMARK(BM_BufferReuse);
 BENCHMARK(BM_BufferRecreate);
 BENCHMARK(BM_BatchOrders)->Range(1, 1 << 10);
+BENCHMARK(BM_FanOutReserialize)->DenseRange(1, 3);
+BENCHMARK(BM_FanOutOverlay)->DenseRange(1, 3);
+BENCHMARK(BM_FirstOrderAfterIdle)
+    ->Args({0, 0})
+    ->Args({1, 20})
+    ->Args({1, 100})
+    ->Iterations(500)
+    ->UseManualTime();
 
 int main(int argc, char** argv) {
   verify_json_serialization();
   // verify_json_dynamic_length();
+  results::init("v4", argc, argv);
   ::benchmark::Initialize(&argc, argv);
   ::benchmark::RunSpecifiedBenchmarks();
+  runtime_stats::snapshot().print();
   return 0;
 }
@@ -0,0 +1,704 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/probes.h"
+#include "common/runtime_stats.h"
+
+#ifndef FORCE_INLINE
+#define FORCE_INLINE __attribute__((always_inline)) inline
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace v4 {
+
+using RequestID = std::uint64_t;
+using ClientOrderID = std::uint64_t;
+using sv = std::string_view;
+
+constexpr int METHOD_PLACE_SIZE = 12;
+constexpr int ACCESS_TKN_SIZE = 400;
+constexpr int INSTRUMENT_SIZE = 35;
+constexpr int TIF_SIZE = 19;
+
+
+template <size_t Capacity>
+class alignas(64) StaticBuffer {
+ public:
+  StaticBuffer() : size_(0) {}
+
+  FORCE_INLINE void clear() { size_ = 0; }
+
+  [[nodiscard]] FORCE_INLINE const char* data() const { return data_; }
+  [[nodiscard]] FORCE_INLINE char* data() { return data_; }
+  [[nodiscard]] FORCE_INLINE size_t size() const { return size_; }
+  [[nodiscard]] FORCE_INLINE sv view() const { return {data_, size_}; }
+  [[nodiscard]] static constexpr size_t capacity() { return Capacity; }
+
+  FORCE_INLINE void set_size(size_t new_size) {
+    if (new_size <= Capacity) {
+      size_ = new_size;
+    } else {
+      runtime_stats::buffer_overflowed();
+      SERIALIZER_PROBE2(buffer_overflow, new_size, Capacity);
+    }
+  }
+
+ private:
+  alignas(64) char data_[Capacity];
+  size_t size_;
+};
+
+struct jsonrpc_t {
+  constexpr static const char* name = "jsonrpc";
+};
+struct method_t {
+  constexpr static const char* name = "method";
+};
+struct request_id_t {
+  constexpr static const char* name = "id";
+};
+struct params_t {
+  constexpr static const char* name = "params";
+};
+struct access_token_t {
+  constexpr static const char* name = "access_token";
+};
+struct instrument_t {
+  constexpr static const char* name = "instrument_name";
+};
+struct amount_t {
+  constexpr static const char* name = "amount";
+};
+struct label_t {
+  constexpr static const char* name = "label";
+};
+struct price_t {
+  constexpr static const char* name = "price";
+};
+struct post_only_t {
+  constexpr static const char* name = "post_only";
+};
+struct reject_post_only_t {
+  constexpr static const char* name = "reject_post_only";
+};
+struct reduce_only_t {
+  constexpr static const char* name = "reduce_only";
+};
+struct time_in_force_t {
+  constexpr static const char* name = "time_in_force";
+};
+struct order_id_t {
+  constexpr static const char* name = "order_id";
+};
+
+namespace schema {
+template <size_t N>
+struct string {
+  using type = sv;
+  static constexpr size_t max_size = N;
+};
+
+template <typename T>
+struct number {
+  using type = T;
+};
+
+struct boolean {
+  using type = bool;
+};
+
+template <typename Key>
+struct fixed_key_value {
+  using key_type = Key;
+};
+
+template <typename Key, typename ValueType>
+struct key_value {
+  using key_type = Key;
+  using value_type = ValueType;
+};
+
+template <typename... Fields>
+struct object {};
+}  // namespace schema
+
+template <typename T>
+FORCE_INLINE int int_to_str(char* buffer, T value) {
+  if (value == 0) {
+    buffer[0] = '0';
+    return 1;
+  }
+
+  bool negative = false;
+  if (value < 0) {
+    negative = true;
+    value = -value;
+  }
+
+  char temp[32];
+  int i = 0;
+  while (value > 0) {
+    temp[i++] = '0' + (value % 10);
+    value /= 10;
+  }
+
+  int result_len = i + (negative ? 1 : 0);
+  if (negative) {
+    buffer[0] = '-';
+  }
+
+  for (int j = 0; j < i; j++) {
+    buffer[(negative ? 1 : 0) + j] = temp[i - j - 1];
+  }
+
+  return result_len;
+}
+
+// Shortest spelling that reads back as the same double, at most 24 chars
+FORCE_INLINE int double_to_str(char* buffer, double value) {
+  auto [ptr, ec] = std::to_chars(buffer, buffer + 32, value);
+  return ec == std::errc() ? static_cast<int>(ptr - buffer) : 0;
+}
+
+using place_schema = schema::object<
+    schema::fixed_key_value<jsonrpc_t>,
+    schema::key_value<method_t, schema::string<METHOD_PLACE_SIZE>>,
+    schema::key_value<request_id_t, schema::number<RequestID>>,
+    schema::key_value<
+        params_t,
+        schema::object<
+            schema::key_value<access_token_t, schema::string<ACCESS_TKN_SIZE>>,
+            schema::key_value<instrument_t, schema::string<INSTRUMENT_SIZE>>,
+            schema::key_value<amount_t, schema::number<double>>,
+            schema::key_value<label_t, schema::number<ClientOrderID>>,
+            schema::key_value<price_t, schema::number<double>>,
+            schema::key_value<post_only_t, schema::boolean>,
+            schema::key_value<reject_post_only_t, schema::boolean>,
+            schema::key_value<reduce_only_t, schema::boolean>,
+            schema::key_value<time_in_force_t, schema::string<TIF_SIZE>>>>>;
+
+using cancel_schema = schema::object<
+    schema::fixed_key_value<jsonrpc_t>,
+    schema::key_value<method_t, schema::string<METHOD_PLACE_SIZE>>,
+    schema::key_value<request_id_t, schema::number<RequestID>>,
+    schema::key_value<
+        params_t,
+        schema::object<
+            schema::key_value<access_token_t, schema::string<ACCESS_TKN_SIZE>>,
+            schema::key_value<order_id_t, schema::string<METHOD_PLACE_SIZE>>>>>;
+
+using edit_schema = schema::object<
+    schema::fixed_key_value<jsonrpc_t>,
+    schema::key_value<method_t, schema::string<METHOD_PLACE_SIZE>>,
+    schema::key_value<request_id_t, schema::number<RequestID>>,
+    schema::key_value<
+        params_t,
+        schema::object<
+            schema::key_value<access_token_t, schema::string<ACCESS_TKN_SIZE>>,
+            schema::key_value<order_id_t, schema::string<METHOD_PLACE_SIZE>>,
+            schema::key_value<amount_t, schema::number<double>>,
+            schema::key_value<price_t, schema::number<double>>,
+            schema::key_value<post_only_t, schema::boolean>,
+            schema::key_value<reduce_only_t, schema::boolean>>>>;
+
+// Message kind a schema is counted under by StatsPolicy
+template <typename Schema>
+inline constexpr runtime_stats::Kind stats_kind = runtime_stats::Kind::Other;
+template <>
+inline constexpr runtime_stats::Kind stats_kind<place_schema> =
+    runtime_stats::Kind::Place;
+template <>
+inline constexpr runtime_stats::Kind stats_kind<edit_schema> =
+    runtime_stats::Kind::Edit;
+template <>
+inline constexpr runtime_stats::Kind stats_kind<cancel_schema> =
+    runtime_stats::Kind::Cancel;
+
+// Byte range of a value inside a serialized frame
+struct SlotRange {
+  uint32_t begin;
+  uint32_t end;
+};
+
+template <typename Schema>
+class Writer {
+ public:
+  explicit Writer(char* buffer, size_t& size)
+      : buffer_(buffer),
+        size_(size),
+        wrote_jsonrpc_(false),
+        wrote_method_(false),
+        wrote_id_(false),
+        started_params_(false),
+        first_param_(true) {
+    buffer_[size_++] = '{';
+  }
+
+  template <typename Tag, typename T>
+  FORCE_INLINE void set(const T& value) {
+    if constexpr (std::is_same_v<Tag, jsonrpc_t>) {
+      write_kv("jsonrpc", "2.0", true);
+      wrote_jsonrpc_ = true;
+    } else if constexpr (std::is_same_v<Tag, method_t>) {
+      write_kv("method", value, !wrote_jsonrpc_);
+      wrote_method_ = true;
+    } else if constexpr (std::is_same_v<Tag, request_id_t>) {
+      add_comma_if_needed(wrote_jsonrpc_ || wrote_method_);
+      write_key("id");
+      id_slot_.begin = static_cast<uint32_t>(size_);
+      write_value(value);
+      id_slot_.end = static_cast<uint32_t>(size_);
+      wrote_id_ = true;
+    }
+  }
+
+  template <typename ParentTag, typename ChildTag, typename T>
+  FORCE_INLINE void set(const T& value) {
+    if constexpr (std::is_same_v<ParentTag, params_t>) {
+      if (!started_params_) start_params();
+      if constexpr (std::is_same_v<ChildTag, access_token_t>) {
+        add_comma_if_needed(!first_param_);
+        write_key(ChildTag::name);
+        token_slot_.begin = static_cast<uint32_t>(size_ + 1);
+        write_value(value);
+        token_slot_.end = static_cast<uint32_t>(size_ - 1);
+      } else {
+        write_field(ChildTag::name, value, first_param_);
+      }
+      first_param_ = false;
+    }
+  }
+
+  // Where the request id and access token values were written
+  [[nodiscard]] FORCE_INLINE SlotRange id_slot() const { return id_slot_; }
+  [[nodiscard]] FORCE_INLINE SlotRange token_slot() const {
+    return token_slot_;
+  }
+
+  FORCE_INLINE size_t finalize() {
+    if (started_params_) {
+      buffer_[size_++] = '}';
+    }
+    buffer_[size_++] = '}';
+    return size_;
+  }
+
+  template <typename SchemaType>
+  FORCE_INLINE void set_fixed_values() {
+    set<jsonrpc_t>("2.0");
+  }
+
+ private:
+  FORCE_INLINE void start_params() {
+    add_comma_if_needed();
+    write_key("params");
+    buffer_[size_++] = '{';
+    started_params_ = true;
+    first_param_ = true;
+  }
+
+  template <typename T>
+  FORCE_INLINE void write_kv(const char* key, const T& value, bool first) {
+    add_comma_if_needed(!first);
+    write_key(key);
+    write_value(value);
+  }
+
+  FORCE_INLINE void write_key(const char* key) {
+    buffer_[size_++] = '"';
+    size_t key_len = strlen(key);
+    std::memcpy(buffer_ + size_, key, key_len);
+    size_ += key_len;
+    buffer_[size_++] = '"';
+    buffer_[size_++] = ':';
+  }
+
+  FORCE_INLINE void add_comma_if_needed(bool needed = true) {
+    if (size_ <= 1) return;
+    if (buffer_[size_ - 1] == '{' || buffer_[size_ - 1] == '[') return;
+    if (needed) buffer_[size_++] = ',';
+  }
+
+  template <typename T>
+  FORCE_INLINE void write_field(const char* name, const T& value, bool first) {
+    add_comma_if_needed(!first);
+    write_key(name);
+    write_value(value);
+  }
+
+  FORCE_INLINE void write_value(const sv& value) {
+    buffer_[size_++] = '"';
+    std::memcpy(buffer_ + size_, value.data(), value.size());
+    size_ += value.size();
+    buffer_[size_++] = '"';
+  }
+
+  FORCE_INLINE void write_value(const char* value) { write_value(sv(value)); }
+
+  FORCE_INLINE void write_value(const std::string& value) {
+    write_value(sv(value));
+  }
+
+  FORCE_INLINE void write_value(int value) {
+    char temp[32];
+    int len = int_to_str(temp, value);
+    std::memcpy(buffer_ + size_, temp, len);
+    size_ += len;
+  }
+
+  FORCE_INLINE void write_value(uint64_t value) {
+    char temp[32];
+    int len = int_to_str(temp, value);
+    std::memcpy(buffer_ + size_, temp, len);
+    size_ += len;
+  }
+
+  FORCE_INLINE void write_value(double value) {
+    char temp[32];
+    int len = double_to_str(temp, value);
+    std::memcpy(buffer_ + size_, temp, len);
+    size_ += len;
+  }
+
+  FORCE_INLINE void write_value(bool value) {
+    const char* str = value ? "true" : "false";
+    size_t len = value ? 4 : 5;
+    std::memcpy(buffer_ + size_, str, len);
+    size_ += len;
+  }
+
+  char* buffer_;
+  size_t& size_;
+  bool wrote_jsonrpc_;
+  bool wrote_method_;
+  bool wrote_id_;
+  bool started_params_;
+  bool first_param_;
+  SlotRange id_slot_{0, 0};
+  SlotRange token_slot_{0, 0};
+};
+
+template <typename Schema, typename BufferType>
+struct WriteImpl {
+  static FORCE_INLINE sv write(BufferType& buffer, auto&& callback) {
+    buffer.clear();
+    size_t size = 0;
+
+    Writer<Schema> writer(buffer.data(), size);
+    writer.template set_fixed_values<Schema>();
+    callback(writer);
+    size = writer.finalize();
+    buffer.set_size(size);
+
+    return buffer.view();
+  }
+};
+
+// One out-of-line copy of WriteImpl::write per schema, buffer and fill
+// type. Serializer::write is inlined into every caller, so each caller gets
+// its own instructions; a hot path that wants CacheWarmer to keep its code
+// warm calls this instead, with the same types the warmer was given.
+template <typename Schema, typename BufferType, typename Fill>
+[[gnu::noinline]] sv write_out_of_line(BufferType& buffer, Fill& fill) {
+  return WriteImpl<Schema, BufferType>::write(buffer, fill);
+}
+
+// Serializer statistics policies. NoStats compiles to nothing; ThreadStats
+// counts every message into a runtime_stats::Block.
+struct NoStats {
+  template <typename Schema>
+  FORCE_INLINE void record(size_t, size_t) {}
+};
+
+struct ThreadStats {
+  runtime_stats::Block* block;
+
+  template <typename Schema>
+  FORCE_INLINE void record(size_t bytes, size_t capacity) {
+    runtime_stats::record(*block, stats_kind<Schema>, bytes, capacity);
+  }
+};
+
+template <typename BufferType, typename StatsPolicy = NoStats>
+class Serializer {
+ public:
+  explicit Serializer(BufferType& buffer, StatsPolicy stats = StatsPolicy())
+      : buffer_(buffer), stats_(stats) {}
+
+  template <typename Schema, typename Callback>
+  FORCE_INLINE sv write(Callback&& callback) {
+    SERIALIZER_PROBE2(message_start, static_cast<int>(stats_kind<Schema>), 0);
+    sv out = WriteImpl<Schema, BufferType>::write(
+        buffer_, std::forward<Callback>(callback));
+    SERIALIZER_PROBE3(message_end, static_cast<int>(stats_kind<Schema>), 0,
+                      out.size());
+    stats_.template record<Schema>(out.size(), buffer_.capacity());
+    return out;
+  }
+
+ private:
+  BufferType& buffer_;
+  [[no_unique_address]] StatsPolicy stats_;
+};
+
+class FdTransport {
+ public:
+  explicit FdTransport(int fd) : fd_(fd) {}
+
+  bool send(std::span<const iovec> parts) {
+    while (!parts.empty()) {
+      const size_t count = std::min<size_t>(parts.size(), IOV_MAX);
+      ssize_t written = ::writev(fd_, parts.data(), static_cast<int>(count));
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+
+      size_t left = static_cast<size_t>(written);
+      size_t i = 0;
+      while (i < count && left >= parts[i].iov_len) {
+        left -= parts[i].iov_len;
+        ++i;
+      }
+      if (i < count && left > 0) {
+        iovec rest{static_cast<char*>(parts[i].iov_base) + left,
+                   parts[i].iov_len - left};
+        if (!send(std::span<const iovec>(&rest, 1))) return false;
+        ++i;
+      }
+      parts = parts.subspan(i);
+    }
+    return true;
+  }
+
+  [[nodiscard]] FORCE_INLINE int fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+struct SessionCredentials {
+  RequestID request_id;
+  sv access_token;
+};
+
+// Serializes a message once and derives per-session variants as iovec
+// overlays: everything but the request id and access token is shared with
+// the one serialized frame. The request id must be set before the
+// access token; write() returns an empty frame, and nothing is fanned
+// out, when either is missing or out of order.
+template <typename BufferType, size_t MaxSessions = 4>
+class FanOut {
+ public:
+  static constexpr size_t PARTS_PER_SESSION = 5;
+
+  explicit FanOut(BufferType& buffer) : buffer_(buffer) {}
+
+  template <typename Schema, typename Callback>
+  FORCE_INLINE sv write(Callback&& callback) {
+    buffer_.clear();
+    size_t size = 0;
+
+    Writer<Schema> writer(buffer_.data(), size);
+    writer.template set_fixed_values<Schema>();
+    callback(writer);
+    size = writer.finalize();
+    buffer_.set_size(size);
+
+    id_slot_ = writer.id_slot();
+    token_slot_ = writer.token_slot();
+    // Both values must have been written, the id first; the writer leaves
+    // a slot at {0, 0} when its field was never set
+    ready_ = id_slot_.begin != 0 && token_slot_.begin != 0 &&
+             id_slot_.begin < id_slot_.end &&
+             id_slot_.end <= token_slot_.begin &&
+             token_slot_.begin <= token_slot_.end && token_slot_.end < size;
+    if (!ready_) return {};
+    return buffer_.view();
+  }
+
+  // Whether the last write() captured both slots; overlay() and submit()
+  // refuse to fan out otherwise
+  [[nodiscard]] FORCE_INLINE bool ready() const { return ready_; }
+
+  // Frame of session i: shared bytes around its own id and token. Empty
+  // for i >= MaxSessions.
+  FORCE_INLINE std::span<const iovec> overlay(size_t i,
+                                              const SessionCredentials& s) {
+    if (!ready_ || i >= MaxSessions) return {};
+    char* base = buffer_.data();
+    char* id = id_digits_[i];
+    const size_t id_len = int_to_str(id, s.request_id);
+
+    iovec* out = parts_[i];
+    out[0] = {base, id_slot_.begin};
+    out[1] = {id, id_len};
+    out[2] = {base + id_slot_.end, token_slot_.begin - id_slot_.end};
+    out[3] = {const_cast<char*>(s.access_token.data()), s.access_token.size()};
+    out[4] = {base + token_slot_.end, buffer_.size() - token_slot_.end};
+    return std::span<const iovec>(out, PARTS_PER_SESSION);
+  }
+
+  // Send one variant per session, session i on transports[i]. Returns the
+  // number of sessions whose write succeeded; a failed session does not
+  // stop the others.
+  FORCE_INLINE size_t submit(std::span<const SessionCredentials> sessions,
+                             std::span<FdTransport> transports) {
+    if (!ready_) return 0;
+    const size_t count = std::min({sessions.size(), transports.size(),
+                                   MaxSessions});
+    size_t sent = 0;
+    for (size_t i = 0; i < count; ++i) {
+      sent += transports[i].send(overlay(i, sessions[i])) ? 1 : 0;
+    }
+    return sent;
+  }
+
+ private:
+  BufferType& buffer_;
+  SlotRange id_slot_{0, 0};
+  SlotRange token_slot_{0, 0};
+  bool ready_ = false;
+  char id_digits_[MaxSessions][24];
+  iovec parts_[MaxSessions][PARTS_PER_SESSION];
+};
+
+struct SteadyClock {
+  static uint64_t now_ns() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+};
+
+struct WarmerStats {
+  uint64_t runs = 0;     // polls that warmed
+  uint64_t busy_ns = 0;  // time spent warming
+  uint64_t since_ns = 0;
+
+  // Fraction of the time since construction or reset spent warming
+  [[nodiscard]] double duty_cycle(uint64_t now_ns) const {
+    return now_ns > since_ns ? static_cast<double>(busy_ns) /
+                                   static_cast<double>(now_ns - since_ns)
+                             : 0.0;
+  }
+};
+
+// Opt-in keepalive for idle order paths. Call poll() from the hot thread's
+// idle loop; once every interval it runs write_out_of_line<Schema> for each
+// registered schema into a private discard buffer and reads one byte per
+// line of each registered data region (the real output buffer, tokens,
+// ...). Nothing written here ever reaches a transport.
+//
+// Data is warmed whatever the hot path looks like. Code and branch history
+// are warmed only if the hot path runs the very same function, i.e. calls
+// write_out_of_line<Schema>(buffer, fill) with a CacheWarmer::Buffer and
+// the fill it registered; an inlined Serializer::write is a separate copy
+// the warmer never executes.
+template <typename Clock = SteadyClock, size_t MaxTasks = 8,
+          size_t MaxRegions = 8>
+class CacheWarmer {
+ public:
+  explicit CacheWarmer(uint64_t interval_ns = 100'000)
+      : interval_ns_(interval_ns) {
+    reset_stats();
+  }
+
+  // Buffer type the hot path must write into to share code with the warmer
+  using Buffer = StaticBuffer<4096>;
+
+  // fill sets dummy values on the Writer, as the real write would; it
+  // must outlive the warmer
+  template <typename Schema, typename Fill>
+  bool add(Fill& fill) {
+    if (task_count_ == MaxTasks) return false;
+    tasks_[task_count_++] = Task{
+        [](void* context, Buffer& discard) {
+          write_out_of_line<Schema>(discard, *static_cast<Fill*>(context));
+        },
+        &fill};
+    return true;
+  }
+
+  bool touch(const void* data, size_t size) {
+    if (region_count_ == MaxRegions) return false;
+    regions_[region_count_++] = Region{static_cast<const char*>(data), size};
+    return true;
+  }
+
+  // Warm if the interval has passed; returns whether it did
+  FORCE_INLINE bool poll() {
+    const uint64_t now = Clock::now_ns();
+    if (now - last_run_ns_ < interval_ns_) return false;
+    warm();
+    const uint64_t end = Clock::now_ns();
+    stats_.busy_ns += end - now;
+    ++stats_.runs;
+    last_run_ns_ = end;
+    return true;
+  }
+
+  void warm() {
+    for (size_t i = 0; i < task_count_; ++i) {
+      tasks_[i].run(tasks_[i].context, discard_);
+    }
+    for (size_t i = 0; i < region_count_; ++i) {
+      const Region& region = regions_[i];
+      for (size_t at = 0; at < region.size; at += 64) {
+        sink_ += static_cast<unsigned char>(
+            *static_cast<const volatile char*>(region.data + at));
+      }
+    }
+  }
+
+  void set_interval(uint64_t interval_ns) { interval_ns_ = interval_ns; }
+  [[nodiscard]] uint64_t interval_ns() const { return interval_ns_; }
+
+  [[nodiscard]] const WarmerStats& stats() const { return stats_; }
+  void reset_stats() {
+    stats_ = WarmerStats{};
+    stats_.since_ns = Clock::now_ns();
+  }
+
+ private:
+  struct Task {
+    void (*run)(void* context, Buffer& discard);
+    void* context;
+  };
+
+  struct Region {
+    const char* data;
+    size_t size;
+  };
+
+  uint64_t interval_ns_;
+  uint64_t last_run_ns_ = 0;
+  WarmerStats stats_;
+  Task tasks_[MaxTasks];
+  size_t task_count_ = 0;
+  Region regions_[MaxRegions];
+  size_t region_count_ = 0;
+  unsigned sink_ = 0;
+  Buffer discard_;
+};
+
+}  // namespace v4
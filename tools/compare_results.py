@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""Compare two benchmark results files and check latency budgets.
+
+    compare_results.py BASE.json NEW.json [--budgets FILE] [--alpha 0.05]
+                       [--threshold 5] [--fail-on-regression]
+    compare_results.py NEW.json --budgets FILE
+
+The files are Google Benchmark JSON as written by the binaries into
+results/ (src/common/results.h). Each benchmark is compared on real time
+and on every *_ns counter (p50_ns, p99_ns, ...). With repetitions
+(--benchmark_repetitions=N, N >= 5 in both runs) a change is reported as
+significant when a two-sided Mann-Whitney U test gives p < alpha and the
+medians differ by more than --threshold percent; fewer runs only show the
+change. Below five runs a side the test cannot reach p < 0.05 however far
+apart the samples are (three a side gives p = 0.1 at best).
+
+A budgets file maps benchmark names (regular expressions matched against
+the whole run name) to ceilings in nanoseconds per metric:
+
+    {"BM_PlaceOrderSerialization": {"real_time": 80, "p99_ns": 250}}
+
+Any budget exceeded by the median of NEW fails the run (exit status 1), as
+does a significant slowdown with --fail-on-regression.
+"""
+
+import argparse
+import json
+import math
+import re
+import statistics
+import sys
+
+TIME_UNIT_NS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+CONTEXT_KEYS = ["cpu_model", "governor", "kernel", "compiler", "flags",
+                "num_cpus", "mhz_per_cpu", "library_build_type"]
+MIN_SAMPLES = 5
+# Exact U distribution up to this many samples in total, when there are no ties
+EXACT_MAX = 40
+
+
+def load(path):
+    """Per run name, per metric: list of samples in ns."""
+    with open(path) as f:
+        data = json.load(f)
+    runs = {}
+    for bench in data.get("benchmarks", []):
+        if bench.get("run_type", "iteration") != "iteration":
+            continue
+        if bench.get("error_occurred"):
+            continue
+        name = bench.get("run_name", bench["name"])
+        scale = TIME_UNIT_NS.get(bench.get("time_unit", "ns"), 1.0)
+        metrics = runs.setdefault(name, {})
+        metrics.setdefault("real_time", []).append(bench["real_time"] * scale)
+        for key, value in bench.items():
+            if key.endswith("_ns") and isinstance(value, (int, float)):
+                metrics.setdefault(key, []).append(float(value))
+    return data.get("context", {}), runs
+
+
+def exact_u_p(u, n1, n2):
+    """Two-sided p-value from the exact distribution of U, no ties."""
+    # counts[k]: orderings of n1 + n2 samples with U = k, built up one
+    # sample at a time
+    counts = {}
+
+    def count(i, j, k):
+        if k < 0 or k > i * j:
+            return 0
+        if i == 0 or j == 0:
+            return 1 if k == 0 else 0
+        key = (i, j, k)
+        if key not in counts:
+            counts[key] = count(i - 1, j, k - j) + count(i, j - 1, k)
+        return counts[key]
+
+    total = math.comb(n1 + n2, n1)
+    u = int(round(u))
+    below = sum(count(n1, n2, k) for k in range(0, u + 1)) / total
+    above = sum(count(n1, n2, k) for k in range(u, n1 * n2 + 1)) / total
+    return min(1.0, 2.0 * min(below, above))
+
+
+def mann_whitney_p(a, b):
+    """Two-sided p-value: exact for small samples without ties, else the
+    normal approximation with tie correction."""
+    n1, n2 = len(a), len(b)
+    ranked = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks = [0.0] * len(ranked)
+    ties = 0.0
+    i = 0
+    while i < len(ranked):
+        j = i
+        while j + 1 < len(ranked) and ranked[j + 1][0] == ranked[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2.0 + 1.0
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+    r1 = sum(r for r, (_, group) in zip(ranks, ranked) if group == 0)
+    u = r1 - n1 * (n1 + 1) / 2.0
+    n = n1 + n2
+    if ties == 0 and n <= EXACT_MAX:
+        return exact_u_p(u, n1, n2)
+    variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(variance)
+    return math.erfc(max(z, 0.0) / math.sqrt(2.0))
+
+
+def compare(base_runs, new_runs, args):
+    rows = []
+    regressions = 0
+    for name in sorted(set(base_runs) & set(new_runs)):
+        for metric in sorted(set(base_runs[name]) & set(new_runs[name])):
+            a, b = base_runs[name][metric], new_runs[name][metric]
+            old, new = statistics.median(a), statistics.median(b)
+            change = (new - old) / old * 100.0 if old else 0.0
+            if len(a) >= MIN_SAMPLES and len(b) >= MIN_SAMPLES:
+                p = mann_whitney_p(a, b)
+                if p < args.alpha and abs(change) > args.threshold:
+                    verdict = "slower" if change > 0 else "faster"
+                else:
+                    verdict = "same"
+                p_text = "%.4f" % p
+            else:
+                verdict, p_text = "?", "n/a"
+            regressions += verdict == "slower"
+            rows.append((name, metric, old, new, change, p_text, verdict))
+
+    width = max([len(r[0]) for r in rows] + [9])
+    print("%-*s %-10s %12s %12s %8s %7s  %s" % (
+        width, "benchmark", "metric", "base", "new", "change", "p", ""))
+    for name, metric, old, new, change, p_text, verdict in rows:
+        print("%-*s %-10s %12.1f %12.1f %+7.1f%% %7s  %s" % (
+            width, name, metric, old, new, change, p_text, verdict))
+
+    only_base = sorted(set(base_runs) - set(new_runs))
+    only_new = sorted(set(new_runs) - set(base_runs))
+    if only_base:
+        print("\nonly in base: " + ", ".join(only_base))
+    if only_new:
+        print("\nonly in new: " + ", ".join(only_new))
+    if any(r[6] == "?" for r in rows):
+        print("\n? = fewer than %d repetitions in a run; rerun with "
+              "--benchmark_repetitions for a significance test" % MIN_SAMPLES)
+    return regressions
+
+
+def check_budgets(new_runs, path):
+    with open(path) as f:
+        budgets = json.load(f)
+    failures = 0
+    print("\nbudgets (%s)" % path)
+    for pattern, limits in budgets.items():
+        regex = re.compile(pattern)
+        matched = [name for name in new_runs if regex.fullmatch(name)]
+        if not matched:
+            print("  %-40s no matching benchmark" % pattern)
+            continue
+        for name in sorted(matched):
+            for metric, limit in limits.items():
+                samples = new_runs[name].get(metric)
+                if not samples:
+                    print("  %-40s %-10s not reported" % (name, metric))
+                    continue
+                value = statistics.median(samples)
+                ok = value <= limit
+                failures += not ok
+                print("  %-40s %-10s %10.1f <= %-10g %s" % (
+                    name, metric, value, limit, "ok" if ok else "OVER BUDGET"))
+    return failures
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare benchmark results and check latency budgets")
+    parser.add_argument("files", nargs="+", metavar="RESULTS.json",
+                        help="BASE NEW, or just NEW with --budgets")
+    parser.add_argument("--budgets", help="JSON file of latency ceilings")
+    parser.add_argument("--alpha", type=float, default=0.05,
+                        help="significance level (default 0.05)")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="smallest change in percent worth reporting "
+                             "(default 5)")
+    parser.add_argument("--fail-on-regression", action="store_true",
+                        help="exit 1 on any significant slowdown")
+    args = parser.parse_args()
+    if len(args.files) > 2 or (len(args.files) == 1 and not args.budgets):
+        parser.error("give BASE NEW, or NEW with --budgets")
+
+    failed = False
+    new_context, new_runs = load(args.files[-1])
+    if len(args.files) == 2:
+        base_context, base_runs = load(args.files[0])
+        for key in CONTEXT_KEYS:
+            old, new = base_context.get(key), new_context.get(key)
+            if old != new:
+                print("warning: %s differs: %r -> %r" % (key, old, new))
+        regressions = compare(base_runs, new_runs, args)
+        failed |= args.fail_on_regression and regressions > 0
+    if args.budgets:
+        failed |= check_budgets(new_runs, args.budgets) > 0
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())